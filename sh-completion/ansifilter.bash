@@ -4,7 +4,7 @@ _ansifilter() {
     args=("${COMP_WORDS[@]}")
     cur="${COMP_WORDS[COMP_CWORD]}"
     prev="${COMP_WORDS[COMP_CWORD-1]}"
-    opts="-i --input -o --output -O --outdir -x --max-size -t --tail -T --text -H --html -M --pango -L --latex -P --tex -R --rtf -S --svg -B --bbcode -a --anchors -d --doc-title -e --encoding -f --fragment -F --font -k --ignore-clear -c --ignore-csi -l --line-numbers -m --map -r --style-ref -s --font-size -p --plain -w --wrap --no-trailing-nl --no-version-info --wrap-no-numbers --derived-styles --art-cp437 --art-bin --art-tundra --art-width --art-height --height --width -v --version -h --help"
+    opts="-i --input -o --output -O --outdir -j --jobs -x --max-size --buffer-size --no-mmap --chunk-size --stats -t --tail --tail-lines -T --text -H --html -M --pango -L --latex -P --tex -R --rtf -S --svg -B --bbcode -a --anchors -d --doc-title -e --encoding -f --fragment -F --font -k --ignore-clear -c --ignore-csi -l --line-numbers -m --map -r --style-ref -s --font-size -p --plain -w --wrap --no-trailing-nl --no-version-info --wrap-no-numbers --derived-styles --art-cp437 --art-bin --art-tundra --art-width --art-height --height --width -v --version -h --help"
 
     case "$prev" in
         -i|--input)
@@ -19,10 +19,14 @@ _ansifilter() {
             COMPREPLY=($(compgen -f -- "$cur"))
             return 0
             ;;
-        -x|--max-size)
+        -x|--max-size|--buffer-size|--chunk-size|--tail-lines|-j|--jobs)
             COMPREPLY=($(compgen -f -- "$cur"))
             return 0
             ;;
+        --stats)
+            COMPREPLY=($(compgen -W "json" -- "$cur"))
+            return 0
+            ;;
         -a|--anchors)
             COMPREPLY=($(compgen -W "self" -- "$cur"))
             return 0
@@ -2,8 +2,14 @@
 complete -c ansifilter -s i -l input -r -d 'Name of input file'
 complete -c ansifilter -s o -l output -r -d 'Name of output file'
 complete -c ansifilter -s O -l outdir -r -d 'Name of output directory'
+complete -c ansifilter -s j -l jobs -r -d 'Convert multiple input files in n threads'
 complete -c ansifilter -s x -l max-size -r -d 'Set maximum input file size (default: 256M)'
+complete -c ansifilter -l buffer-size -r -d 'Set output buffer size (default: 256K)'
+complete -c ansifilter -l no-mmap -d 'Read input files as stream instead of mapping them into memory'
+complete -c ansifilter -l chunk-size -r -d 'Set minimum chunk size of a single input file converted with --jobs (default: 8M)'
+complete -c ansifilter -l stats -xa 'json' -d 'Print conversion statistics of each input file to stderr'
 complete -c ansifilter -s t -l tail -d 'Continue reading after end-of-file (like tail -f)'
+complete -c ansifilter -l tail-lines -r -d 'Print the last n lines of the input file, then continue reading'
 complete -c ansifilter -s T -l text -d 'Output text'
 complete -c ansifilter -s H -l html -d 'Output HTML'
 complete -c ansifilter -s M -l pango -d 'Output Pango Markup'
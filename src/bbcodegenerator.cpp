@@ -106,23 +106,4 @@ void BBCodeGenerator::printBody()
     processInput();
 }
 
-string BBCodeGenerator::maskCharacter(unsigned char c)
-{
-
-    switch (c) {
-
-    case '\t' : // see deletion of nonprintable chars below
-        return "\t";
-        break;
-    default :
-        if (c>0x1f ) { // printable?
-            return string( 1, c );;
-        } else {
-            return "";
-        }
-    }
-
-    return "";
-}
-
 }
@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+#-*- coding: utf-8 -*-
+
+# Deterministic corpus generator for the ansifilter benchmarks.
+# The same size and seed always produce the same bytes, so results of
+# different releases can be compared.
+#
+# usage: gen_corpus.py [--size 4M] [--seed 1] [--out DIR] [KIND ...]
+
+import argparse
+import os
+import random
+import struct
+import sys
+
+ESC = "\033["
+
+LEVELS = ["DEBUG", "INFO", "INFO", "INFO", "WARN", "ERROR"]
+WORDS = ("request session user cache worker queue backend timeout retry "
+         "connection handler upstream config shard replica index token "
+         "commit rollback payload latency socket buffer").split()
+UTF8_WORDS = ("Grüße Straße naïve façade déjà señor Ærø Ωμέγα Привет мир "
+              "日本語 テキスト 中文字符 한국어 العربية עברית ✓ ✗ → ★ ♥ "
+              "🚀 📦 ✨ 🔥 ∑ ∞ ≠ ½").split()
+CP437_BLOCKS = [0xB0, 0xB1, 0xB2, 0xDB, 0xDC, 0xDD, 0xDE, 0xDF, 0xC4, 0xCD, 0xBA, 0xB3]
+
+
+def parse_size(text):
+    factor = {"K": 1 << 10, "M": 1 << 20, "G": 1 << 30}.get(text[-1:].upper(), 1)
+    return int(text.rstrip("kKmMgG")) * factor
+
+
+def sentence(rng, count, words=WORDS):
+    return " ".join(rng.choice(words) for _ in range(count))
+
+
+def timestamp(i):
+    return "2024-05-%02d %02d:%02d:%02d.%03d" % (1 + i // 86400000 % 28, i // 3600000 % 24,
+                                                i // 60000 % 60, i // 1000 % 60, i % 1000)
+
+
+def line_plain(rng, i):
+    return "%s [%-5s] pid=%d %s\n" % (timestamp(i * 37), rng.choice(LEVELS),
+                                      rng.randint(100, 99999), sentence(rng, rng.randint(4, 16)))
+
+
+def line_sgr(rng, i):
+    # test runner output: every token has its own colour
+    status = rng.choice([ESC + "1;32mPASS" + ESC + "0m", ESC + "1;32mPASS" + ESC + "0m",
+                         ESC + "1;31mFAIL" + ESC + "0m", ESC + "33mSKIP" + ESC + "0m"])
+    name = ESC + "36m" + "tests/%s_%s.py" % (rng.choice(WORDS), rng.choice(WORDS)) + ESC + "0m"
+    test = ESC + "1m" + "::test_%s_%d" % (rng.choice(WORDS), i) + ESC + "22m"
+    dur = ESC + "2m(%d ms)" % rng.randint(1, 5000) + ESC + "0m"
+    return "%s %s%s %s %s%s%s\n" % (status, name, test, dur, ESC + "4m",
+                                    sentence(rng, rng.randint(0, 4)), ESC + "24m")
+
+
+def line_256(rng, i):
+    start = rng.randint(16, 231)
+    cells = []
+    for x in range(rng.randint(20, 60)):
+        cells.append("%s38;5;%dm%s48;5;%dm#" % (ESC, (start + x) % 240 + 16, ESC, (start + 2 * x) % 256))
+    return "".join(cells) + ESC + "0m\n"
+
+
+def line_truecolor(rng, i):
+    cells = []
+    r, g, b = rng.randint(0, 255), rng.randint(0, 255), rng.randint(0, 255)
+    for x in range(rng.randint(20, 60)):
+        cells.append("%s38;2;%d;%d;%dm%s48;2;%d;%d;%dm=" % (ESC, (r + x * 3) % 256, (g + x * 5) % 256, b,
+                                                         ESC, b, (g + x) % 256, (r + x * 7) % 256))
+    return "".join(cells) + ESC + "0m\n"
+
+
+def line_osc8(rng, i):
+    url = "https://example.com/%s/%d" % (rng.choice(WORDS), rng.randint(1, 100000))
+    link = "\033]8;;%s\a%s\033]8;;\a" % (url, rng.choice(WORDS))
+    return "%s see %s for %s\n" % (timestamp(i * 13), link, sentence(rng, rng.randint(2, 8)))
+
+
+def line_progress(rng, i):
+    # a progress bar which is redrawn with CR, like curl or pip output
+    steps = []
+    for p in range(0, 101, rng.choice([5, 10, 20])):
+        bar = "#" * (p // 5) + " " * (20 - p // 5)
+        steps.append("\r%s%s%s [%s] %3d%%" % (ESC, "32m", rng.choice(WORDS), bar, p))
+    return "".join(steps) + ESC + "0m\n"
+
+
+def line_utf8(rng, i):
+    words = [rng.choice(UTF8_WORDS) for _ in range(rng.randint(4, 14))]
+    if rng.random() < 0.3:
+        words[0] = ESC + "35m" + words[0] + ESC + "0m"
+    return " ".join(words) + "\n"
+
+
+TEXT_KINDS = {
+    "plain": line_plain,
+    "sgr": line_sgr,
+    "256color": line_256,
+    "truecolor": line_truecolor,
+    "osc8": line_osc8,
+    "progress": line_progress,
+    "utf8": line_utf8,
+}
+
+
+def gen_text(kind, size, seed):
+    rng = random.Random("%s-%d" % (kind, seed))
+    make_line = TEXT_KINDS[kind]
+    parts = []
+    total = 0
+    i = 0
+    while total < size:
+        data = make_line(rng, i).encode("utf-8")
+        parts.append(data)
+        total += len(data)
+        i += 1
+    return b"".join(parts)
+
+
+def gen_cp437(size, seed):
+    # ANSI art: CP437 block characters, colours and cursor movements, 80 columns
+    rng = random.Random("cp437-%d" % seed)
+    out = bytearray()
+    while len(out) < size:
+        col = 0
+        while col < 80:
+            out += ("\033[%d;%dm" % (rng.randint(30, 37), rng.randint(40, 47))).encode()
+            run = min(rng.randint(1, 12), 80 - col)
+            if rng.random() < 0.1:
+                out += ("\033[%dC" % run).encode()
+            else:
+                out += bytes(rng.choice(CP437_BLOCKS) for _ in range(run))
+            col += run
+        out += b"\033[0m\r\n"
+    return bytes(out)
+
+
+def bin_cells(rng, count):
+    cells = bytearray()
+    for _ in range(count):
+        cells.append(rng.choice(CP437_BLOCKS) if rng.random() < 0.7 else rng.randint(0x20, 0x7e))
+        cells.append(rng.randint(0, 255))
+    return cells
+
+
+def gen_bin(size, seed):
+    # BIN: character/attribute pairs of 160 columns
+    rng = random.Random("bin-%d" % seed)
+    rows = max(1, size // 320)
+    return bytes(bin_cells(rng, rows * 160))
+
+
+def gen_xbin(size, seed):
+    # XBIN with RLE compressed image; the format stores width and height in
+    # 16 bit, ansifilter reads up to 255 rows
+    rng = random.Random("xbin-%d" % seed)
+    width = 80
+    height = max(1, min(255, size // (width * 2)))
+    out = bytearray(b"XBIN\x1a")
+    out += struct.pack("<HHBB", width, height, 16, 4)
+    cells = bin_cells(rng, width * height)
+    for start in range(0, len(cells), 128):
+        block = cells[start:start + 128]
+        out.append(len(block) // 2 - 1)   # uncompressed run
+        out += block
+    return bytes(out)
+
+
+ART_KINDS = {
+    "cp437": (gen_cp437, ".ans"),
+    "bin": (gen_bin, ".bin"),
+    "xbin": (gen_xbin, ".xb"),
+}
+
+ALL_KINDS = list(TEXT_KINDS) + list(ART_KINDS)
+
+
+def corpus_path(directory, kind, size_text):
+    suffix = ART_KINDS[kind][1] if kind in ART_KINDS else ".txt"
+    return os.path.join(directory, "%s-%s%s" % (kind, size_text, suffix))
+
+
+def generate(directory, kind, size_text, seed=1):
+    """Write the corpus file if it does not exist yet and return its path."""
+    path = corpus_path(directory, kind, size_text)
+    if not os.path.exists(path):
+        size = parse_size(size_text)
+        if kind in ART_KINDS:
+            data = ART_KINDS[kind][0](size, seed)
+        else:
+            data = gen_text(kind, size, seed)
+        os.makedirs(directory, exist_ok=True)
+        with open(path + ".tmp", "wb") as f:
+            f.write(data)
+        os.replace(path + ".tmp", path)
+    return path
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate benchmark input files")
+    parser.add_argument("--size", default="4M", help="approximate size of each file (K, M, G suffix)")
+    parser.add_argument("--seed", type=int, default=1, help="random seed")
+    parser.add_argument("--out", default="bench-corpus", help="output directory")
+    parser.add_argument("kinds", nargs="*", choices=ALL_KINDS + [[]], help="corpus kinds (default: all)")
+    args = parser.parse_args()
+
+    for kind in args.kinds or ALL_KINDS:
+        print(generate(args.out, kind, args.size, args.seed))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
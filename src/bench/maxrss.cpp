@@ -0,0 +1,64 @@
+/***************************************************************************
+                          maxrss.cpp  -  description
+                             -------------------
+    copyright            : (C) 2024 by Andre Simon
+    email                : a.simon@mailbox.org
+ ***************************************************************************/
+
+/*
+This file is part of ANSIFilter.
+
+ANSIFilter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ANSIFilter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Runs a command and prints its peak resident set size in KiB to stderr,
+   like GNU time -f %M. run_bench.py starts ansifilter through this helper:
+   Linux keeps the peak RSS of a process across exec, so a child which was
+   forked by the Python interpreter reports at least the RSS of Python.
+
+   usage: maxrss COMMAND [ARGS...] */
+
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(int argc, char* argv[])
+{
+    if (argc<2) {
+        fprintf(stderr, "usage: maxrss COMMAND [ARGS...]\n");
+        return EXIT_FAILURE;
+    }
+    pid_t pid = fork();
+    if (pid<0) {
+        perror("maxrss: fork");
+        return EXIT_FAILURE;
+    }
+    if (pid==0) {
+        execvp(argv[1], argv+1);
+        perror("maxrss: exec");
+        _exit(127);
+    }
+
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage)<0) {
+        perror("maxrss: wait4");
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, "%ld\n", usage.ru_maxrss);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128+WTERMSIG(status);
+}
@@ -0,0 +1,419 @@
+/***************************************************************************
+                          microbench.cpp  -  description
+                             -------------------
+    copyright            : (C) 2024 by Andre Simon
+    email                : a.simon@mailbox.org
+ ***************************************************************************/
+
+/*
+This file is part of ANSIFilter.
+
+ANSIFilter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ANSIFilter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Microbenchmarks of the parser and generator hot functions.
+
+   usage: microbench [--filter TEXT] [--min-time MS] [--input FILE] [--json FILE]
+
+   Every benchmark cycles through a fixed set of inputs, so the results of
+   two builds are comparable. With --input the SGR sequences, characters and
+   lines of FILE replace the built-in sample. Allocations are counted by
+   replacing the global operator new. The generateString and generate
+   benchmarks convert a snippet of about 1 KB of whole input lines. */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "codegenerator.h"
+#include "outputsink.h"
+
+static size_t allocationCount = 0;
+
+void* operator new(size_t size)
+{
+    ++allocationCount;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+/// results are accumulated here, so the compiler cannot drop the calls
+static volatile size_t benchmarkSink = 0;
+
+namespace ansifilter
+{
+
+/** \brief Calls the private members of CodeGenerator for the benchmarks */
+
+class MicroBenchmark
+{
+public:
+    static bool parseSGRParameters(CodeGenerator& g, std::string_view seq)
+    {
+        // the parameters are located between ESC[ and m
+        return g.parseSGRParameters(seq, 2, seq.size() - 1);
+    }
+
+    static void xterm2rgb(CodeGenerator& g, unsigned char colour, unsigned char* rgb)
+    {
+        g.xterm2rgb(colour, rgb);
+    }
+
+    static string maskCharacter(CodeGenerator& g, unsigned char c)
+    {
+        return g.maskCharacter(c);
+    }
+
+    static string maskCP437Character(CodeGenerator& g, unsigned char c)
+    {
+        return g.maskCP437Character(c);
+    }
+
+    static string getOpenTag(CodeGenerator& g, const ElementStyle& style)
+    {
+        g.elementStyle = style;
+        return g.getOpenTag();
+    }
+
+    static string getCloseTag(CodeGenerator& g, const ElementStyle& style)
+    {
+        g.elementStyle = style;
+        return g.getCloseTag();
+    }
+
+    static void printNewLine(CodeGenerator& g, std::string_view line)
+    {
+        g.lineBuf.append(line.data(), line.size());
+        g.printNewLine();
+    }
+
+    static void setOutput(CodeGenerator& g, OutputSink* sink)
+    {
+        g.out = sink;
+    }
+
+    /** \return styles which result of the SGR sequences */
+    static vector<ElementStyle> parseStyles(CodeGenerator& g, const vector<string>& sequences)
+    {
+        vector<ElementStyle> styles;
+        for (const string& seq : sequences) {
+            g.parseSGRParameters(seq, 2, seq.size() - 1);
+            styles.push_back(g.elementStyle);
+        }
+        return styles;
+    }
+};
+
+}
+
+using namespace ansifilter;
+
+namespace
+{
+
+struct Result {
+    string name;
+    double nsPerOp;
+    double allocsPerOp;
+};
+
+struct Options {
+    string filter;
+    string inputFile;
+    string jsonFile;
+    double minTime = 0.2;
+};
+
+const char* sampleText =
+    "\033[1;32mPASS\033[0m \033[36mtests/test_parser.py\033[0m::test_<escape> & \"quote\" (12 ms)\n"
+    "2024-05-01 12:00:00 [\033[33mWARN\033[0m] cache {miss} for key=user#42 $HOME\\path 100%\n"
+    "\033[38;5;208mdiff --git a/src/x.cpp b/src/x.cpp\033[0m\n"
+    "\033[38;2;255;128;0;48;2;0;0;64mtruecolor ~ gradient_text ^ {block}\033[0m\n"
+    "\033[1m\033[4mbold and underlined\033[22;24m normal \033[7minverse\033[27m\n"
+    "\033[3;31;44mitalic red on blue\033[39;49m default \033[9mstrike\033[0m\n"
+    "\033[4:3mcurly underline\033[4:0m \033[90mbright black\033[97;100m white\033[0m\n"
+    "plain text line without any escape sequence, but with <html> & {tex} characters\n";
+
+/** \return SGR sequences of the text, ESC[ ... m */
+vector<string> extractSGRSequences(const string& text)
+{
+    vector<string> sequences;
+    size_t pos = 0;
+    while ((pos = text.find("\033[", pos)) != string::npos) {
+        size_t end = pos + 2;
+        while (end < text.size() && (text[end] < 0x40 || text[end] > 0x7e)) {
+            ++end;
+        }
+        if (end < text.size() && text[end] == 'm') {
+            sequences.push_back(text.substr(pos, end - pos + 1));
+        }
+        pos = end;
+    }
+    return sequences;
+}
+
+/** \return lines of the text without escape sequences */
+vector<string> extractLines(const string& text)
+{
+    vector<string> lines;
+    std::istringstream stream(text);
+    string line;
+    while (std::getline(stream, line)) {
+        string plain;
+        for (size_t i = 0; i < line.size(); ++i) {
+            if (line[i] == '\033') {
+                while (i < line.size() && line[i] != 'm') {
+                    ++i;
+                }
+            } else {
+                plain += line[i];
+            }
+        }
+        lines.push_back(plain);
+    }
+    return lines;
+}
+
+/** Run op(i) with increasing i until minTime has passed
+    \return fastest ns/op of three runs and the allocations per op */
+Result measure(const string& name, double minTime, const std::function<void(size_t)>& op)
+{
+    using Clock = std::chrono::steady_clock;
+
+    // find the iteration count which takes a tenth of the minimum time
+    size_t iterations = 1;
+    for (;;) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            op(i);
+        }
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        if (elapsed >= minTime / 10 || iterations >= (size_t(1) << 40)) {
+            iterations = size_t(iterations * (minTime / 3) / (elapsed > 0 ? elapsed : 1e-9)) + 1;
+            break;
+        }
+        iterations *= 2;
+    }
+
+    Result result { name, 0.0, 0.0 };
+    for (int run = 0; run < 3; ++run) {
+        size_t allocations = allocationCount;
+        auto start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            op(i);
+        }
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+        if (run == 0 || ns < result.nsPerOp) {
+            result.nsPerOp = ns;
+        }
+        result.allocsPerOp = double(allocationCount - allocations) / iterations;
+    }
+    return result;
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        string arg(argv[i]);
+        if (i + 1 < argc && arg == "--filter") {
+            options.filter = argv[++i];
+        } else if (i + 1 < argc && arg == "--min-time") {
+            options.minTime = std::atof(argv[++i]) / 1000.0;
+        } else if (i + 1 < argc && arg == "--input") {
+            options.inputFile = argv[++i];
+        } else if (i + 1 < argc && arg == "--json") {
+            options.jsonFile = argv[++i];
+        } else {
+            std::cerr << "usage: microbench [--filter TEXT] [--min-time MS] [--input FILE] [--json FILE]\n";
+            return false;
+        }
+    }
+    return options.minTime > 0;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return EXIT_FAILURE;
+    }
+
+    string text(sampleText);
+    if (!options.inputFile.empty()) {
+        std::ifstream file(options.inputFile, std::ios::binary);
+        if (!file) {
+            std::cerr << "microbench: could not read " << options.inputFile << "\n";
+            return EXIT_FAILURE;
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        text = contents.str();
+    }
+
+    vector<string> sequences = extractSGRSequences(text);
+    vector<string> lines = extractLines(text);
+    if (sequences.empty() || lines.empty()) {
+        std::cerr << "microbench: the input contains no SGR sequences or lines\n";
+        return EXIT_FAILURE;
+    }
+
+    // about 1 KB of whole lines for the conversion of strings
+    string snippet;
+    while (snippet.size() < 1024) {
+        snippet += text;
+    }
+    size_t snippetEnd = snippet.rfind('\n', 1023);
+    snippet.resize(snippetEnd == string::npos ? 1024 : snippetEnd + 1);
+
+    const vector<string> colourStrings = { "#ff8800", "#1e90ff", "00 80 ff", "#000000", "ff ff ff" };
+    vector<StyleColour> colours;
+    for (int i = 0; i < 64; ++i) {
+        colours.emplace_back((unsigned char)(i * 37), (unsigned char)(i * 11), (unsigned char)(255 - i * 5));
+    }
+
+    const struct {
+        const char* name;
+        OutputType type;
+    } generators[] = {
+        { "text", TEXT }, { "html", HTML }, { "latex", LATEX }, { "tex", TEX },
+        { "rtf", RTF }, { "svg", SVG }, { "bbcode", BBCODE }, { "pango", PANGO },
+    };
+
+    NullOutputSink nullSink;
+    vector<Result> results;
+    auto run = [&](const string& name, const std::function<void(size_t)>& op) {
+        if (name.find(options.filter) == string::npos) {
+            return;
+        }
+        results.push_back(measure(name, options.minTime, op));
+        const Result& r = results.back();
+        printf("%-40s %10.1f ns/op %8.2f allocs/op\n", r.name.c_str(), r.nsPerOp, r.allocsPerOp);
+        fflush(stdout);
+    };
+
+    std::unique_ptr<CodeGenerator> html(CodeGenerator::getInstance(HTML));
+
+    run("CodeGenerator::parseSGRParameters", [&](size_t i) {
+        benchmarkSink += MicroBenchmark::parseSGRParameters(*html, sequences[i % sequences.size()]);
+    });
+
+    run("CodeGenerator::xterm2rgb", [&](size_t i) {
+        unsigned char rgb[3];
+        MicroBenchmark::xterm2rgb(*html, (unsigned char)i, rgb);
+        benchmarkSink += rgb[0] + rgb[1] + rgb[2];
+    });
+
+    // the request names it rgb2html, the hex formatting is done by StyleColour
+    run("StyleColour::getRed/Green/Blue(HTML)", [&](size_t i) {
+        const StyleColour& c = colours[i % colours.size()];
+        benchmarkSink += c.getRed(HTML).size() + c.getGreen(HTML).size() + c.getBlue(HTML).size();
+    });
+
+    run("StyleColour::setRGB", [&](size_t i) {
+        StyleColour c;
+        c.setRGB(colourStrings[i % colourStrings.size()]);
+        benchmarkSink += c.getRGB();
+    });
+
+    for (const auto& gen : generators) {
+        std::unique_ptr<CodeGenerator> g(CodeGenerator::getInstance(gen.type));
+        MicroBenchmark::setOutput(*g, &nullSink);
+        vector<ElementStyle> styles = MicroBenchmark::parseStyles(*g, sequences);
+        string prefix = string(gen.name) + "::";
+
+        run(prefix + "maskCharacter", [&](size_t i) {
+            benchmarkSink += MicroBenchmark::maskCharacter(*g, (unsigned char)text[i % text.size()]).size();
+        });
+        run(prefix + "getOpenTag", [&](size_t i) {
+            benchmarkSink += MicroBenchmark::getOpenTag(*g, styles[i % styles.size()]).size();
+        });
+        run(prefix + "getCloseTag", [&](size_t i) {
+            benchmarkSink += MicroBenchmark::getCloseTag(*g, styles[i % styles.size()]).size();
+        });
+        run(prefix + "printNewLine", [&](size_t i) {
+            MicroBenchmark::printNewLine(*g, lines[i % lines.size()]);
+        });
+        if (gen.type == HTML) {
+            run(prefix + "maskCP437Character", [&](size_t i) {
+                benchmarkSink += MicroBenchmark::maskCP437Character(*g, (unsigned char)i).size();
+            });
+        }
+        MicroBenchmark::setOutput(*g, nullptr);
+
+        // document fragments, like the snippets of the language bindings
+        g->setFragmentCode(true);
+        run(prefix + "generateString(1KB)", [&](size_t) {
+            benchmarkSink += g->generateString(snippet).size();
+        });
+        string output;
+        run(prefix + "generate(1KB)", [&](size_t) {
+            g->generate(snippet, output);
+            benchmarkSink += output.size();
+        });
+    }
+
+    if (!options.jsonFile.empty()) {
+        std::ofstream json(options.jsonFile);
+        json << "{\n  \"min_time_ms\": " << options.minTime * 1000.0 << ",\n  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            json << "    { \"name\": \"" << results[i].name << "\", \"ns_per_op\": " << results[i].nsPerOp
+                 << ", \"allocs_per_op\": " << results[i].allocsPerOp << " }"
+                 << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        json << "  ]\n}\n";
+        if (!json) {
+            std::cerr << "microbench: could not write " << options.jsonFile << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+#-*- coding: utf-8 -*-
+
+# End-to-end throughput benchmark of the ansifilter binary.
+# Every corpus of gen_corpus.py is converted with each output format and
+# option set; MB/s, lines/s and the peak RSS are reported as table and JSON.
+#
+# usage: run_bench.py [--binary src/ansifilter] [--size 4M] [--json FILE]
+#                     [--baseline OLD.json] [--max-regression 10]
+#                     [--rss-helper src/maxrss]
+
+import argparse
+import json
+import os
+import platform
+import subprocess
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import gen_corpus
+
+FORMATS = {
+    "text": "-T",
+    "html": "-H",
+    "latex": "-L",
+    "tex": "-P",
+    "rtf": "-R",
+    "svg": "-S",
+    "bbcode": "-B",
+    "pango": "-M",
+}
+
+# option sets applied to the text corpora; the art corpora are laid out on a
+# fixed canvas where line numbers and wrapping do not apply
+OPTION_SETS = {
+    "default": [],
+    "line-numbers": ["-l"],
+    "wrap": ["-w", "80"],
+    "derived-styles": ["--derived-styles"],
+    "no-mmap": ["--no-mmap"],
+}
+
+# only these formats emit a stylesheet for --derived-styles
+DERIVED_FORMATS = ("html", "svg")
+
+
+def art_options(kind, path):
+    if kind == "cp437":
+        return ["--art-cp437"]
+    rows = os.path.getsize(path) // 320 if kind == "bin" else 255
+    return ["--art-bin", "--art-height", str(max(1, rows))]
+
+
+def rss_wrapper(helper):
+    """Return the command prefix which reports the peak RSS of a command in KiB
+    as last line of stderr: GNU time if available, else the maxrss helper.
+    Linux keeps the peak RSS of the parent across exec, so ansifilter is
+    started from one of these small processes instead of this interpreter."""
+    time_cmd = ["/usr/bin/time", "-f", "%M"]
+    if os.access(time_cmd[0], os.X_OK) and subprocess.run(
+            time_cmd + ["true"], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL).returncode == 0:
+        return time_cmd
+    if helper and os.access(helper, os.X_OK):
+        return [os.path.abspath(helper)]
+    return []
+
+
+def run_once(cmd, wrapper):
+    """Run cmd and return the wall time in seconds and the peak RSS in KiB."""
+    start = time.perf_counter()
+    proc = subprocess.Popen(wrapper + cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    _, status, usage = os.wait4(proc.pid, 0)
+    elapsed = time.perf_counter() - start
+    proc.returncode = os.waitstatus_to_exitcode(status)
+    err = proc.stderr.read().decode(errors="replace")
+    proc.stderr.close()
+    max_rss = usage.ru_maxrss
+    if wrapper:
+        err, _, last = err.strip().rpartition("\n")
+        max_rss = int(last) if last.isdigit() else 0
+    if proc.returncode != 0:
+        raise RuntimeError("%s failed (%d): %s" % (" ".join(cmd), proc.returncode, err.strip()))
+    return elapsed, max_rss
+
+
+def rss_floor(wrapper):
+    """Without a wrapper no child of this script reports less than the RSS of
+    the interpreter. Values at this floor only mean that ansifilter did not
+    need more."""
+    return run_once(["true"], wrapper)[1]
+
+
+def count_lines(path):
+    with open(path, "rb") as f:
+        return sum(chunk.count(b"\n") for chunk in iter(lambda: f.read(1 << 20), b""))
+
+
+def cases(kinds, formats, option_sets):
+    for kind in kinds:
+        for fmt in formats:
+            if kind in gen_corpus.ART_KINDS:
+                yield kind, fmt, "default"
+                continue
+            for name in option_sets:
+                if name == "derived-styles" and fmt not in DERIVED_FORMATS:
+                    continue
+                yield kind, fmt, name
+
+
+def version(binary):
+    out = subprocess.run([binary, "--version"], stdout=subprocess.PIPE, check=False).stdout
+    lines = out.decode(errors="replace").strip().splitlines()
+    return lines[0].strip() if lines else "unknown"
+
+
+def load_baseline(path):
+    with open(path) as f:
+        data = json.load(f)
+    return {(r["corpus"], r["format"], r["options"]): r for r in data["results"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure the ansifilter throughput")
+    parser.add_argument("--binary", default="src/ansifilter", help="ansifilter executable")
+    parser.add_argument("--size", default="4M", help="size of each corpus (K, M, G suffix)")
+    parser.add_argument("--seed", type=int, default=1, help="corpus random seed")
+    parser.add_argument("--corpus-dir", default="bench-corpus", help="corpus directory")
+    parser.add_argument("--repeat", type=int, default=3, help="runs per case, the fastest is reported")
+    parser.add_argument("--corpora", default=",".join(gen_corpus.ALL_KINDS),
+                        help="comma separated corpus kinds")
+    parser.add_argument("--formats", default=",".join(FORMATS), help="comma separated output formats")
+    parser.add_argument("--options", default=",".join(OPTION_SETS), help="comma separated option sets")
+    parser.add_argument("--rss-helper", default="src/maxrss", metavar="FILE",
+                        help="maxrss executable, used if GNU time is not available")
+    parser.add_argument("--json", metavar="FILE", help="write the results to FILE")
+    parser.add_argument("--baseline", metavar="FILE", help="compare with the JSON results of an older run")
+    parser.add_argument("--max-regression", type=float, metavar="PCT",
+                        help="fail if a case is more than PCT percent slower than the baseline")
+    args = parser.parse_args()
+
+    kinds = args.corpora.split(",")
+    formats = args.formats.split(",")
+    option_sets = args.options.split(",")
+    for name, valid in ((kinds, gen_corpus.ALL_KINDS), (formats, FORMATS), (option_sets, OPTION_SETS)):
+        unknown = [n for n in name if n not in valid]
+        if unknown:
+            parser.error("unknown value %s, expected one of %s" % (unknown[0], ", ".join(valid)))
+
+    baseline = load_baseline(args.baseline) if args.baseline else {}
+    binary = os.path.abspath(args.binary)
+
+    corpora = {}
+    for kind in kinds:
+        path = gen_corpus.generate(args.corpus_dir, kind, args.size, args.seed)
+        corpora[kind] = (path, os.path.getsize(path), count_lines(path))
+
+    wrapper = rss_wrapper(args.rss_helper)
+    floor = rss_floor(wrapper)
+    print("%-10s %-7s %-15s %9s %12s %9s %8s" % ("corpus", "format", "options",
+                                               "MB/s", "lines/s", "RSS KiB", "change"))
+    results = []
+    regressions = []
+    for kind, fmt, opt_name in cases(kinds, formats, option_sets):
+        path, size, lines = corpora[kind]
+        cmd = [binary, FORMATS[fmt], "-i", path, "-o", os.devnull]
+        cmd += art_options(kind, path) if kind in gen_corpus.ART_KINDS else OPTION_SETS[opt_name]
+
+        runs = [run_once(cmd, wrapper) for _ in range(max(1, args.repeat))]
+        seconds = min(r[0] for r in runs)
+        result = {
+            "corpus": kind,
+            "format": fmt,
+            "options": opt_name,
+            "arguments": cmd[1:2] + cmd[6:],
+            "bytes": size,
+            "lines": lines,
+            "seconds": round(seconds, 6),
+            "mb_per_s": round(size / seconds / 1e6, 2),
+            "lines_per_s": round(lines / seconds),
+            "max_rss_kib": max(r[1] for r in runs),
+        }
+        results.append(result)
+
+        change = ""
+        old = baseline.get((kind, fmt, opt_name))
+        if old:
+            pct = (result["mb_per_s"] / old["mb_per_s"] - 1.0) * 100.0
+            change = "%+.1f%%" % pct
+            if args.max_regression is not None and -pct > args.max_regression:
+                regressions.append(result)
+        print("%-10s %-7s %-15s %9.2f %12d %9d %8s" % (kind, fmt, opt_name, result["mb_per_s"],
+                                                     result["lines_per_s"], result["max_rss_kib"], change))
+        sys.stdout.flush()
+
+    if args.json:
+        report = {
+            "version": version(binary),
+            "date": time.strftime("%Y-%m-%dT%H:%M:%S"),
+            "machine": platform.machine(),
+            "system": platform.platform(),
+            "cpus": os.cpu_count(),
+            "size": args.size,
+            "seed": args.seed,
+            "repeat": args.repeat,
+            "max_rss_floor_kib": floor,
+            "results": results,
+        }
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=2)
+            f.write("\n")
+
+    print("RSS values of %d KiB or less are the measurement floor of this script" % floor)
+    if regressions:
+        print("%d case(s) more than %.1f%% slower than the baseline" % (len(regressions), args.max_regression))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,149 @@
+/***************************************************************************
+                          bytescanner.cpp  -  description
+                             -------------------
+    copyright            : (C) 2024 by Andre Simon
+    email                : a.simon@mailbox.org
+ ***************************************************************************/
+
+/*
+This file is part of ANSIFilter.
+
+ANSIFilter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ANSIFilter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bytescanner.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BYTESCANNER_X86
+#include <immintrin.h>
+#endif
+
+namespace ByteScanner
+{
+
+/// byte classes: 1 = always special, 2 = special if 8 bit controls are enabled
+struct ByteClassTable {
+    unsigned char cls[256];
+
+    constexpr ByteClassTable() : cls()
+    {
+        cls[0x07] = cls[0x08] = cls[0x0d] = cls[0x1b] = 1;
+        cls[0xc2] = 2;
+        for (int c=0x90; c<=0x9f; c++) cls[c] = 2;
+    }
+};
+
+static constexpr ByteClassTable byteClasses;
+
+static size_t findScalar(const char* data, size_t len, bool c1Controls)
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char mask = c1Controls ? 3 : 1;
+    for (size_t i=0; i<len; i++) {
+        if (byteClasses.cls[p[i]] & mask) return i;
+    }
+    return len;
+}
+
+#ifdef BYTESCANNER_X86
+
+__attribute__((target("sse2")))
+static size_t findSSE2(const char* data, size_t len, bool c1Controls)
+{
+    const __m128i bel = _mm_set1_epi8(0x07);
+    const __m128i bs  = _mm_set1_epi8(0x08);
+    const __m128i cr  = _mm_set1_epi8(0x0d);
+    const __m128i esc = _mm_set1_epi8(0x1b);
+    const __m128i c2  = _mm_set1_epi8((char)0xc2);
+    const __m128i highNibble = _mm_set1_epi8((char)0xf0);
+    const __m128i c1Range = _mm_set1_epi8((char)0x90);
+
+    size_t i=0;
+    for (; i+16<=len; i+=16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data+i));
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, bel), _mm_cmpeq_epi8(v, bs)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, esc)));
+        if (c1Controls) {
+            m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, c2),
+                                             _mm_cmpeq_epi8(_mm_and_si128(v, highNibble), c1Range)));
+        }
+        int bits = _mm_movemask_epi8(m);
+        if (bits) return i + __builtin_ctz(bits);
+    }
+    return i + findScalar(data+i, len-i, c1Controls);
+}
+
+__attribute__((target("avx2")))
+static size_t findAVX2(const char* data, size_t len, bool c1Controls)
+{
+    const __m256i bel = _mm256_set1_epi8(0x07);
+    const __m256i bs  = _mm256_set1_epi8(0x08);
+    const __m256i cr  = _mm256_set1_epi8(0x0d);
+    const __m256i esc = _mm256_set1_epi8(0x1b);
+    const __m256i c2  = _mm256_set1_epi8((char)0xc2);
+    const __m256i highNibble = _mm256_set1_epi8((char)0xf0);
+    const __m256i c1Range = _mm256_set1_epi8((char)0x90);
+
+    size_t i=0;
+    for (; i+32<=len; i+=32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data+i));
+        __m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, bel), _mm256_cmpeq_epi8(v, bs)),
+                                    _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, esc)));
+        if (c1Controls) {
+            m = _mm256_or_si256(m, _mm256_or_si256(_mm256_cmpeq_epi8(v, c2),
+                                                   _mm256_cmpeq_epi8(_mm256_and_si256(v, highNibble), c1Range)));
+        }
+        unsigned int bits = (unsigned int)_mm256_movemask_epi8(m);
+        if (bits) return i + __builtin_ctz(bits);
+    }
+    // avoid the AVX-SSE transition penalty in the SSE2 code of the tail
+    _mm256_zeroupper();
+    return i + findSSE2(data+i, len-i, c1Controls);
+}
+
+#endif
+
+typedef size_t (*FindFunction)(const char*, size_t, bool);
+
+static FindFunction selectImplementation(const char** name)
+{
+#ifdef BYTESCANNER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "avx2";
+        return findAVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        *name = "sse2";
+        return findSSE2;
+    }
+#endif
+    *name = "scalar";
+    return findScalar;
+}
+
+static const char* implementationName = nullptr;
+static const FindFunction findImplementation = selectImplementation(&implementationName);
+
+size_t findSpecialByte(const char* data, size_t len, bool c1Controls)
+{
+    return findImplementation(data, len, c1Controls);
+}
+
+const char* getImplementationName()
+{
+    return implementationName;
+}
+
+}
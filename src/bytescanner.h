@@ -0,0 +1,49 @@
+/***************************************************************************
+                          bytescanner.h  -  description
+                             -------------------
+    copyright            : (C) 2024 by Andre Simon
+    email                : a.simon@mailbox.org
+ ***************************************************************************/
+
+/*
+This file is part of ANSIFilter.
+
+ANSIFilter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ANSIFilter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BYTESCANNER_H
+#define BYTESCANNER_H
+
+#include <cstddef>
+
+/// Contains methods to locate bytes which start escape sequences or control functions
+
+namespace ByteScanner
+{
+
+/** Find the next byte which needs special treatment by the parser: BEL, BS,
+    CR, ESC and - if c1Controls is set - 0xC2 and the C1 range 0x90-0x9F.
+    SSE2 or AVX2 code is selected at runtime if the CPU supports it.
+    \param data input bytes
+    \param len number of bytes
+    \param c1Controls also stop at 8 bit control characters
+    \return index of the first special byte, or len if there is none */
+size_t findSpecialByte(const char* data, size_t len, bool c1Controls);
+
+/** \return name of the selected implementation (avx2, sse2 or scalar) */
+const char* getImplementationName();
+
+}
+
+#endif
@@ -44,3 +44,300 @@ else
   echo "Output  test #2 is not right, FAIL"
   exit 1
 fi
+
+
+# test case #3: parallel conversion of files with different colour palettes
+# (XBIN files carry their own palette) must match the sequential output
+
+TMPDIR=`mktemp -d`
+mkdir -p $TMPDIR/in $TMPDIR/seq $TMPDIR/par
+for i in 1 2 3 4; do
+  cp ./ansi_art_samples/misfit_LetsGoCrazy.xb $TMPDIR/in/art$i.xb
+  cp ./ansi_art_samples/2013-16-TCF-16-Colors.bin $TMPDIR/in/art$i.bin
+done
+
+./src/ansifilter -H --art-bin -O $TMPDIR/seq/ $TMPDIR/in/* && ./src/ansifilter -H --art-bin --jobs=4 -O $TMPDIR/par/ $TMPDIR/in/*
+RETVAL=$?
+
+if [ $RETVAL -eq 0 ]; then
+  echo "Retval test #3 is 0, OK"
+else
+  echo "Retval test #3 is not 0, FAIL"
+  rm -rf $TMPDIR
+  exit 1
+fi
+
+if diff -r $TMPDIR/seq $TMPDIR/par >/dev/null; then
+  echo "Output test #3 is correct, OK"
+else
+  echo "Output test #3 is not right, FAIL"
+  rm -rf $TMPDIR
+  exit 1
+fi
+rm -rf $TMPDIR
+
+
+# test case #4: a single file converted in parallel chunks must match the
+# sequential output, including line numbers, wrapping and derived styles
+
+TMPDIR=`mktemp -d`
+mkdir -p $TMPDIR/seq $TMPDIR/par
+for i in `seq 20`; do
+  cat ./src/ci_test_line.col ./ansi_art_samples/Luciano-6-FreedomTrainGameCities.ans
+done > $TMPDIR/input.log
+BIN=`pwd`/src/ansifilter
+
+for OPTS in "-T" "-H -l" "-H -l -w 60" "-H --derived-styles -l -w 40" "-L -l" "-S --derived-styles"; do
+  (cd $TMPDIR/seq && $BIN $OPTS -i ../input.log -o out) && (cd $TMPDIR/par && $BIN $OPTS --jobs=4 --chunk-size=16K -i ../input.log -o out)
+  RETVAL=$?
+
+  if [ $RETVAL -ne 0 ]; then
+    echo "Retval test #4 ($OPTS) is not 0, FAIL"
+    rm -rf $TMPDIR
+    exit 1
+  fi
+
+  if ! diff -r $TMPDIR/seq $TMPDIR/par >/dev/null; then
+    echo "Output test #4 ($OPTS) is not right, FAIL"
+    rm -rf $TMPDIR
+    exit 1
+  fi
+  rm -f $TMPDIR/seq/* $TMPDIR/par/*
+done
+echo "Output test #4 is correct, OK"
+rm -rf $TMPDIR
+
+
+# test case #5: --tail follows appended data and a rotated input file
+
+TMPDIR=`mktemp -d`
+echo "first" > $TMPDIR/input.log
+./src/ansifilter -t $TMPDIR/input.log > $TMPDIR/out &
+PID=$!
+sleep 0.5
+echo "appended" >> $TMPDIR/input.log
+sleep 0.5
+mv $TMPDIR/input.log $TMPDIR/input.log.1
+echo "rotated" > $TMPDIR/input.log
+sleep 1.5
+kill $PID
+wait $PID 2>/dev/null
+
+if [ "`cat $TMPDIR/out`" == "first
+appended
+rotated" ]; then
+  echo "Output test #5 is correct, OK"
+else
+  echo "Output test #5 is not right, FAIL"
+  rm -rf $TMPDIR
+  exit 1
+fi
+rm -rf $TMPDIR
+
+
+# test case #6: --tail-lines prints the last lines with the formatting in effect
+
+TMPDIR=`mktemp -d`
+printf 'first\n\033[31mred\nstill red\nlast red\n' > $TMPDIR/input.log
+./src/ansifilter -H -f --tail-lines=2 $TMPDIR/input.log > $TMPDIR/out &
+PID=$!
+sleep 0.5
+kill $PID
+wait $PID 2>/dev/null
+
+if [ "`cat $TMPDIR/out`" == '<span style="color:#cd0000;">still red
+last red' ]; then
+  echo "Output test #6 is correct, OK"
+else
+  echo "Output test #6 is not right, FAIL"
+  rm -rf $TMPDIR
+  exit 1
+fi
+rm -rf $TMPDIR
+
+
+# test case #7: --stats counts the lines and sequences of the input, other
+# values than json are rejected
+
+TMPDIR=`mktemp -d`
+printf '\033[1;32mPASS\033[0m \033]8;;https://example.com\007link\033]8;;\007\nprog 1%%\rprog 100%%\033[2J\n' > $TMPDIR/input.log
+./src/ansifilter -i $TMPDIR/input.log -o $TMPDIR/out --stats=json 2> $TMPDIR/stats
+./src/ansifilter -i $TMPDIR/input.log -o $TMPDIR/out --stats=jsn 2> $TMPDIR/invalid
+RETVAL=$?
+
+if [ $RETVAL -eq 1 ] && grep -q "invalid argument 'jsn'" $TMPDIR/invalid \
+   && grep -q '"bytes_in":74,"bytes_out":41,"lines":2,"sgr_sequences":2,"csi_sequences":1,"osc_sequences":1,"hyperlinks":1,"ignored_sequences":0,"distinct_styles":1,"line_rewinds":1' $TMPDIR/stats; then
+  echo "Output test #7 is correct, OK"
+else
+  echo "Output test #7 is not right, FAIL"
+  cat $TMPDIR/stats
+  rm -rf $TMPDIR
+  exit 1
+fi
+rm -rf $TMPDIR
+
+# test case #8: art mode cells of the same style share one span
+
+TMPDIR=`mktemp -d`
+printf '\033[31mAAA\033[32mBB\r\n' > $TMPDIR/input.ans
+./src/ansifilter -H -f --art-cp437 --art-width=5 --art-height=1 -i $TMPDIR/input.ans -o $TMPDIR/out
+
+if grep -qx '<span style="color:#cd0000;">AAA</span><span style="color:#00cd00;">BB</span>' $TMPDIR/out; then
+  echo "Output test #8 is correct, OK"
+else
+  echo "Output test #8 is not right, FAIL"
+  cat $TMPDIR/out
+  rm -rf $TMPDIR
+  exit 1
+fi
+rm -rf $TMPDIR
+
+# test case #9: --tail-lines=0 prints only appended data (like tail -n 0 -f)
+
+TMPDIR=`mktemp -d`
+printf 'first\n\033[31mred\nlast red\n' > $TMPDIR/input.log
+./src/ansifilter -H -f --tail-lines=0 $TMPDIR/input.log > $TMPDIR/out &
+PID=$!
+sleep 0.5
+printf 'appended\n' >> $TMPDIR/input.log
+sleep 1.5
+kill $PID
+wait $PID 2>/dev/null
+
+if [ "`cat $TMPDIR/out`" == '<span style="color:#cd0000;">appended' ]; then
+  echo "Output test #9 is correct, OK"
+else
+  echo "Output test #9 is not right, FAIL"
+  cat $TMPDIR/out
+  rm -rf $TMPDIR
+  exit 1
+fi
+rm -rf $TMPDIR
+
+# test case #10: --no-trailing-nl keeps the whole last line, also if it is
+# longer than the read block and the output buffer
+
+TMPDIR=`mktemp -d`
+printf 'first\n\033[32m' > $TMPDIR/input.log
+head -c 300000 /dev/zero | tr '\0' 'x' >> $TMPDIR/input.log
+for OPTS in "" "--no-mmap" "--buffer-size=4K"; do
+  ./src/ansifilter -T $OPTS -i $TMPDIR/input.log -o $TMPDIR/out
+  ./src/ansifilter -T --no-trailing-nl $OPTS -i $TMPDIR/input.log -o $TMPDIR/out_nonl
+  printf '\n' >> $TMPDIR/out_nonl
+  ./src/ansifilter -H -f $OPTS -i $TMPDIR/input.log | tr -d '\n' > $TMPDIR/html
+  ./src/ansifilter -H -f --no-trailing-nl $OPTS -i $TMPDIR/input.log | tr -d '\n' > $TMPDIR/html_nonl
+  if ! cmp -s $TMPDIR/out $TMPDIR/out_nonl || ! cmp -s $TMPDIR/html $TMPDIR/html_nonl; then
+    echo "Output test #10 ($OPTS) is not right, FAIL"
+    rm -rf $TMPDIR
+    exit 1
+  fi
+done
+echo "Output test #10 is correct, OK"
+rm -rf $TMPDIR
+
+# test case #11: generators converting concurrently in threads, each with
+# its own colour map (setColorMap), match the single threaded output
+
+TMPDIR=`mktemp -d`
+if ${MAKE:-make} -s -C ./src -f ./makefile palette-test >/dev/null && ./src/palette-test $TMPDIR 8 50; then
+  echo "Output test #11 is correct, OK"
+else
+  echo "Output test #11 is not right, FAIL"
+  rm -rf $TMPDIR
+  exit 1
+fi
+rm -rf $TMPDIR
+
+# test case #12: a memory mapped input file which is truncated during the
+# conversion is reported as read error instead of crashing with SIGBUS
+
+TMPDIR=`mktemp -d`
+head -c 8000000 /dev/zero | tr '\0' 'a' | fold -w 79 > $TMPDIR/input.log
+mkfifo $TMPDIR/fifo
+# the conversion blocks on the output pipe until it is read
+./src/ansifilter -H -i $TMPDIR/input.log -o $TMPDIR/fifo 2> $TMPDIR/err &
+PID=$!
+exec 3<$TMPDIR/fifo
+sleep 0.5
+: > $TMPDIR/input.log
+cat <&3 >/dev/null
+exec 3<&-
+wait $PID
+RETVAL=$?
+
+if [ $RETVAL -eq 1 ] && grep -q "could not read input" $TMPDIR/err; then
+  echo "Output test #12 is correct, OK"
+else
+  echo "Output test #12 is not right (exit code $RETVAL), FAIL"
+  rm -rf $TMPDIR
+  exit 1
+fi
+rm -rf $TMPDIR
+
+# test case #13: a missing input file does not stop the conversion of the
+# others, with and without --jobs
+
+TMPDIR=`mktemp -d`
+printf '\033[31mone\n' > $TMPDIR/a.log
+printf '\033[32mtwo\n' > $TMPDIR/c.log
+for JOBS in 1 2; do
+  mkdir -p $TMPDIR/out$JOBS
+  ./src/ansifilter -H --jobs=$JOBS -O $TMPDIR/out$JOBS/ $TMPDIR/a.log $TMPDIR/b.log $TMPDIR/c.log 2> $TMPDIR/err$JOBS
+  RETVAL=$?
+  if [ $RETVAL -ne 1 ] || [ ! -s $TMPDIR/out$JOBS/a.log.html ] || [ ! -s $TMPDIR/out$JOBS/c.log.html ] \
+     || ! grep -q "could not read input: $TMPDIR/b.log" $TMPDIR/err$JOBS; then
+    echo "Output test #13 (--jobs=$JOBS) is not right, FAIL"
+    rm -rf $TMPDIR
+    exit 1
+  fi
+done
+
+if cmp -s $TMPDIR/err1 $TMPDIR/err2 && diff -r $TMPDIR/out1 $TMPDIR/out2 >/dev/null; then
+  echo "Output test #13 is correct, OK"
+else
+  echo "Output test #13 is not right, FAIL"
+  rm -rf $TMPDIR
+  exit 1
+fi
+rm -rf $TMPDIR
+
+# test case #14: the derived style classes of parallel conversions do not
+# depend on the thread scheduling, and the stylesheet defines all of them
+
+TMPDIR=`mktemp -d`
+for F in 1 2 3 4 5 6; do
+  for C in 1 2 3 4 5 6 7; do
+    printf "\033[3$(( (C*F)%8 ));4$(( (C+F)%8 ))mline $C\033[0m\n"
+  done > $TMPDIR/in$F.log
+done
+for RUN in 1 2; do
+  mkdir -p $TMPDIR/out$RUN
+  ./src/ansifilter -H --derived-styles --jobs=4 -O $TMPDIR/out$RUN/ $TMPDIR/in*.log
+done
+for CLASS in `cat $TMPDIR/out1/*.html | grep -o 'af_[0-9][0-9]*' | sort -u`; do
+  if ! grep -q "^span\.$CLASS " $TMPDIR/out1/derived_styles.css; then
+    echo "Output test #14 ($CLASS not defined) is not right, FAIL"
+    rm -rf $TMPDIR
+    exit 1
+  fi
+done
+
+if [ -s $TMPDIR/out1/derived_styles.css ] && diff -r $TMPDIR/out1 $TMPDIR/out2 >/dev/null; then
+  echo "Output test #14 is correct, OK"
+else
+  echo "Output test #14 is not right, FAIL"
+  rm -rf $TMPDIR
+  exit 1
+fi
+rm -rf $TMPDIR
+
+# test case #15: incremental conversions (begin, feed, finish) with input
+# pieces of random size match generate() in all output formats
+
+if ${MAKE:-make} -s -C ./src -f ./makefile push-test >/dev/null \
+   && ./src/push-test 20 64 ./src/ci_test_line.col ./ansi_art_samples/Luciano-6-FreedomTrainGameCities.ans; then
+  echo "Output test #15 is correct, OK"
+else
+  echo "Output test #15 is not right, FAIL"
+  exit 1
+fi
@@ -27,11 +27,15 @@ along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
 #include <string>
 #include <vector>
 #include <list>
+#include <thread>
+#include <algorithm>
 
 #include "arg_parser.h"
 #include "cmdlineoptions.h"
 #include "platform_fs.h"
 #include "stringtools.h"
+#include "outputsink.h"
+#include "codegenerator.h"
 
 
 const Arg_parser::Option options[] = {
@@ -44,6 +48,7 @@ const Arg_parser::Option options[] = {
     { 'H', "html",       Arg_parser::no  },
     { 'M', "pango",      Arg_parser::no  },
     { 'i', "input",      Arg_parser::yes },
+    { 'j', "jobs",       Arg_parser::yes },
     { 'l', "line-numbers", Arg_parser::no },
     { 'L', "latex",      Arg_parser::no  },
     { 'P', "tex",        Arg_parser::no  },
@@ -77,6 +82,14 @@ const Arg_parser::Option options[] = {
     { 'x', "max-size",   Arg_parser::yes  },
     { 'g', "no-default-fg", Arg_parser::no  },
     { 'A', "line-append",   Arg_parser::yes  },
+    { 'b', "buffer-size",   Arg_parser::yes  },
+    { 'I', "no-mmap",       Arg_parser::no  },
+    { 'J', "chunk-size",    Arg_parser::yes  },
+    { 'G', "tail-lines",    Arg_parser::yes  },
+#ifndef ANSIFILTER_NO_STATS
+    // without statistics --stats is rejected as unknown option
+    { 'K', "stats",         Arg_parser::maybe  },
+#endif
 
     {  0,  nullptr,           Arg_parser::no  }
 };
@@ -102,13 +115,19 @@ CmdLineOptions::CmdLineOptions( const int argc, const char *argv[] ):
     opt_genDynStyles(false),
     opt_funny_anchors(false),
     opt_omit_default_fg_color(false),
+    opt_no_mmap(false),
+    opt_stats(false),
+    opt_stats_json(false),
     encodingName("ISO-8859-1"),
     font("Courier New"),
     fontSize("10pt"),
     wrapLineLen(0),
     asciiArtWidth(80),
     asciiArtHeight(100),
-    maxFileSize(268435456)
+    maxFileSize(268435456),
+    outputBufferSize(ansifilter::OutputSink::defaultBufferSize),
+    chunkSize(ansifilter::CodeGenerator::defaultChunkSize),
+    jobs(1)
 {
     char* hlEnvOptions=getenv("ANSIFILTER_OPTIONS");
     if (hlEnvOptions!=nullptr) {
@@ -211,6 +230,22 @@ void CmdLineOptions::parseRuntimeOptions( const int argc, const char *argv[], bo
         case 't':
             opt_ignoreEOF = true;
             break;
+        case 'G':
+            tailLines = 0;
+            StringTools::str2num<size_t> ( *tailLines, arg, std::dec );
+            opt_ignoreEOF = true;
+            break;
+#ifndef ANSIFILTER_NO_STATS
+        case 'K':
+            if (!arg.empty() && arg!="json") {
+                cerr << "ansifilter: invalid argument '" << arg << "' for option '--stats'\n";
+                cerr << "Try 'ansifilter --help' for more information.\n";
+                exit( 1 );
+            }
+            opt_stats = true;
+            opt_stats_json = arg=="json";
+            break;
+#endif
         case 'T':
             outputType = ansifilter::TEXT;
             break;
@@ -261,6 +296,15 @@ void CmdLineOptions::parseRuntimeOptions( const int argc, const char *argv[], bo
         case 'g':
             opt_omit_default_fg_color = true;
             break;
+        case 'I':
+            opt_no_mmap = true;
+            break;
+        case 'j':
+            StringTools::str2num<unsigned int> ( jobs, arg, std::dec );
+            if (jobs==0) {
+                jobs = std::max(1u, std::thread::hardware_concurrency());
+            }
+            break;
         case 'Q':
             width=arg;
             break;
@@ -279,6 +323,26 @@ void CmdLineOptions::parseRuntimeOptions( const int argc, const char *argv[], bo
             }
             break;
         }
+        case 'b': {
+            StringTools::str2num<size_t> ( outputBufferSize, arg, std::dec );
+            switch (arg[arg.size()-1]) {
+                case 'M': outputBufferSize *= 1024;
+                case 'K': outputBufferSize *= 1024;
+            }
+            break;
+        }
+        case 'J': {
+            StringTools::str2num<size_t> ( chunkSize, arg, std::dec );
+            switch (arg[arg.size()-1]) {
+                case 'G': chunkSize *= 1024;
+                case 'M': chunkSize *= 1024;
+                case 'K': chunkSize *= 1024;
+            }
+            if (chunkSize==0) {
+                chunkSize = ansifilter::CodeGenerator::defaultChunkSize;
+            }
+            break;
+        }
         default:
             cerr << "ansifilter: option parsing failed" << endl;
         }
@@ -335,7 +399,7 @@ string CmdLineOptions::getDirName(const string & path)
     return (dirNameLength==string::npos)?string():path.substr(0, dirNameLength+1);
 }
 
-string CmdLineOptions::getLineAppendage() {
+string CmdLineOptions::getLineAppendage() const {
     return lineAppendage;
 }
 
@@ -476,6 +540,10 @@ bool CmdLineOptions::omitDefaultForegroundColor() const
 {
     return opt_omit_default_fg_color;
 }
+bool CmdLineOptions::noMemoryMapping() const
+{
+    return opt_no_mmap;
+}
 
 string CmdLineOptions::getDocumentTitle() const
 {
@@ -516,3 +584,33 @@ off_t CmdLineOptions::getMaxFileSize() const
 {
     return maxFileSize;
 }
+
+unsigned int CmdLineOptions::getJobs() const
+{
+    return jobs;
+}
+
+size_t CmdLineOptions::getOutputBufferSize() const
+{
+    return outputBufferSize;
+}
+
+size_t CmdLineOptions::getChunkSize() const
+{
+    return chunkSize;
+}
+
+std::optional<size_t> CmdLineOptions::getTailLines() const
+{
+    return tailLines;
+}
+
+bool CmdLineOptions::printStats() const
+{
+    return opt_stats;
+}
+
+bool CmdLineOptions::printStatsAsJSON() const
+{
+    return opt_stats_json;
+}
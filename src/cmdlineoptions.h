@@ -32,6 +32,7 @@ along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <optional>
 #include "enums.h"
 
 using std::string;
@@ -87,7 +88,7 @@ public:
     string getOutFileSuffix() const;
 
     /** \return Line append string */
-    string getLineAppendage();
+    string getLineAppendage() const;
 
     /** \return Output file format */
     ansifilter::OutputType getOutputType() const;
@@ -141,6 +142,9 @@ public:
 
     bool omitDefaultForegroundColor() const;
 
+    /** \return True if input files should not be memory mapped */
+    bool noMemoryMapping() const;
+
     /** \return Document title */
     string getDocumentTitle() const ;
 
@@ -167,6 +171,24 @@ public:
     /** \return Allowed input file size */
     off_t getMaxFileSize() const;
 
+    /** \return Number of files to convert in parallel */
+    unsigned int getJobs() const;
+
+    /** \return Size of the output buffer */
+    size_t getOutputBufferSize() const;
+
+    /** \return Minimum size of the chunks of a single input file converted with --jobs */
+    size_t getChunkSize() const;
+
+    /** \return Number of lines printed before following the input file, empty if not set */
+    std::optional<size_t> getTailLines() const;
+
+    /** \return True if conversion statistics should be printed */
+    bool printStats() const;
+
+    /** \return True if the statistics should be printed as JSON */
+    bool printStatsAsJSON() const;
+
 private:
     ansifilter::OutputType outputType;
 
@@ -191,6 +213,9 @@ private:
     bool opt_genDynStyles;
     bool opt_funny_anchors;
     bool opt_omit_default_fg_color;
+    bool opt_no_mmap;
+    bool opt_stats;
+    bool opt_stats_json;
 
     // name of single output file
     string outFilename;
@@ -210,6 +235,10 @@ private:
     int asciiArtHeight;
 
     off_t maxFileSize;
+    size_t outputBufferSize;
+    size_t chunkSize;
+    std::optional<size_t> tailLines;
+    unsigned int jobs;
 
     /** list of all input file names */
     vector <string> inputFileNames;
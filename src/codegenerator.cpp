@@ -29,12 +29,18 @@ along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
 #include <windows.h>
 #else
 #include <unistd.h>
+#include <fcntl.h>
 #endif
 
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <algorithm>
 #include <array>
+#include <charconv>
+#include <condition_variable>
+#include <limits>
+#include <thread>
 
 #include "version.h"
 
@@ -46,10 +52,45 @@ along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
 #include "latexgenerator.h"
 #include "bbcodegenerator.h"
 #include "svggenerator.h"
+#include "bytescanner.h"
+#include "probes.h"
 
 namespace ansifilter
 {
 
+/// maximum number of ':' separated values of a SGR parameter
+static const size_t maxSGRSubParams = 8;
+
+/// default escape table, removes control characters
+static constexpr EscapeTable printableEscapeTable = makeEscapeTable();
+
+/** \brief Read-only stream buffer on existing memory, avoids the copy of istringstream */
+class ViewStreamBuf : public std::streambuf
+{
+public:
+    explicit ViewStreamBuf(std::string_view data)
+    {
+        char* p = const_cast<char*>(data.data());
+        setg(p, p, p + data.size());
+    }
+
+protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        off_type base = dir==std::ios_base::beg ? 0 : dir==std::ios_base::cur ? gptr()-eback() : egptr()-eback();
+        if (!(which & std::ios_base::in) || base+off < 0 || base+off > egptr()-eback()) {
+            return pos_type(off_type(-1));
+        }
+        setg(eback(), eback()+base+off, egptr());
+        return pos_type(base+off);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+};
+
 CodeGenerator * CodeGenerator::getInstance(OutputType type)
 {
     CodeGenerator* generator=nullptr;
@@ -91,6 +132,7 @@ CodeGenerator::CodeGenerator(ansifilter::OutputType type)
      tagIsOpen(false),
      encoding("none"),
      docTitle("Source file"),
+     escapeTable(&printableEscapeTable),
      fragmentOutput(false),
      font("Courier New"),
      fontSize("10pt"),
@@ -102,19 +144,25 @@ CodeGenerator::CodeGenerator(ansifilter::OutputType type)
      numberWrappedLines ( true ), //TODO add option
      numberCurrentLine(false),
      addAnchors(false),
+     addFunnyAnchors(false),
      applyDynStyles(false),
      omitVersionInfo(false),
      parseCP437(false),
      parseAsciiBin(false),
      parseAsciiTundra(false),
+     styleRegistry(&ownStyleRegistry),
 
      outputType(type),
+     tagCacheHits(0),
+     tagCacheMisses(0),
      ignoreFormatting(false),
      readAfterEOF(false),
+     useMemoryMapping(true),
      omitTrailingCR(false),
      ignClearSeq(false),
      ignCSISeq(false),
      termBuffer(nullptr),
+     lastTermStyle(0),
      curX(0),
      curY(0),
      memX(0),
@@ -122,15 +170,38 @@ CodeGenerator::CodeGenerator(ansifilter::OutputType type)
      maxY(0),
      asciiArtWidth(80),
      asciiArtHeight(150),
-     lineWrapLen(0)
+     artWidthOption(80),
+     artHeightOption(150),
+     lineWrapLen(0),
+     outputBufferSize(OutputSink::defaultBufferSize),
+     plainTxtCnt(0),
+     lineOffset(0),
+     seqEnd(string::npos),
+     tagOpen(false),
+     lineStart(true),
+     omitNewLine(false),
+     skipLineRest(false),
+     scanOnly(false),
+     collectStats(false),
+     statsReadBase(0),
+     statsWallStart(0.0),
+     statsCpuStart(0.0),
+     chunkSize(defaultChunkSize)
 {
+    memcpy(colorMapPalette, defaultPalette, sizeof defaultPalette);
+    memcpy(workingPalette, defaultPalette, sizeof defaultPalette);
 }
 
-CodeGenerator::~CodeGenerator() = default;
+CodeGenerator::~CodeGenerator()
+{
+    abandonPush();
+    delete [] termBuffer;
+}
 
 void CodeGenerator::setDefaultForegroundColor()
 {
-    elementStyle.setFgColour(rgb2html(workingPalette[0]));
+    initialStyle.setFgColour(StyleColour(workingPalette[0]));
+    elementStyle = initialStyle;
 }
 
 void CodeGenerator::setShowLineNumbers(bool flag)
@@ -150,6 +221,7 @@ void CodeGenerator::setWrapNoNumbers(bool flag)
 
 void CodeGenerator::setParseCodePage437(bool flag){
     parseCP437 = flag;
+    clearTagCache();
 }
 
 void CodeGenerator::setParseAsciiBin(bool flag){
@@ -169,8 +241,8 @@ void CodeGenerator::setIgnoreCSISeq(bool flag) {
 }
 
 void CodeGenerator::setAsciiArtSize(int width, int height){
-    if (width>0) asciiArtWidth = width;
-    if (height>0) asciiArtHeight = height;
+    if (width>0) asciiArtWidth = artWidthOption = width;
+    if (height>0) asciiArtHeight = artHeightOption = height;
 }
 
 bool CodeGenerator::getFragmentCode()
@@ -202,6 +274,39 @@ void CodeGenerator::setLineAppendage(const string& a) {
   lineAppendage = a;
 }
 
+void CodeGenerator::setOutputBufferSize(size_t size) {
+  outputBufferSize = size;
+}
+
+void CodeGenerator::setChunkWorkers(const vector<CodeGenerator*>& workers, size_t size) {
+    chunkWorkers = workers;
+    chunkSize = size;
+}
+
+OutputSink* CodeGenerator::openOutput(const string& outFileName)
+{
+#ifdef WIN32
+    // keep the newline translation of text mode streams
+    ostream* os = outFileName.empty()? &cout : new ofstream (outFileName.c_str());
+    if (os->fail()) {
+        if (!outFileName.empty()) delete os;
+        return nullptr;
+    }
+    return new StreamOutputSink(os, !outFileName.empty(), outputBufferSize);
+#else
+    if (outFileName.empty()) {
+        // preceding output of cout must not be overtaken
+        cout.flush();
+        return new FdOutputSink(STDOUT_FILENO, false, outputBufferSize);
+    }
+    int fd = open(outFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        return nullptr;
+    }
+    return new FdOutputSink(fd, true, outputBufferSize);
+#endif
+}
+
 
 string CodeGenerator::getTitle()
 {
@@ -227,6 +332,7 @@ void CodeGenerator::setPreformatting ( WrapMode lineWrappingStyle,
 
 void CodeGenerator::setApplyDynStyles(bool flag) {
     applyDynStyles = flag;
+    clearTagCache();
 }
 
 void CodeGenerator::setSVGSize ( const string& w, const string& h )
@@ -245,8 +351,8 @@ ParseError CodeGenerator::generateFile (const string &inFileName,
 
 
     if (!in->fail() && error==PARSE_OK) {
-        out = (outFileName.empty()? &cout :new ofstream (outFileName.c_str()));
-        if ( out->fail()) {
+        out = openOutput(outFileName);
+        if ( !out ) {
             error=BAD_OUTPUT;
         }
     }
@@ -255,18 +361,44 @@ ParseError CodeGenerator::generateFile (const string &inFileName,
         error=BAD_INPUT;
     }
     if (error==PARSE_OK) {
+        if (!inFileName.empty() && useMemoryMapping && !readAfterEOF) {
+            mappedInput.map(inFileName);
+        }
+        if (!inFileName.empty() && readAfterEOF) {
+            followedInput.open(inFileName);
+        }
+
+        AF_PROBE2(file_open, inFileName.c_str(),
+                  mappedInput.getData() ? (int64_t)mappedInput.getSize() : (int64_t)-1);
+        beginStats();
+
         if (! fragmentOutput) {
             *out << getHeader();
         }
 
         printBody();
 
+        // the input file was truncated during the conversion
+        if (mappedInput.isTruncated()) {
+            error=BAD_INPUT;
+        }
+        mappedInput.unmap();
+        followedInput.close();
+
         if (! fragmentOutput) {
             *out << getFooter();
         }
     }
 
-    if (!outFileName.empty()) {
+    if (out) {
+        out->flush();
+        if (error==PARSE_OK) {
+            endStats();
+            AF_PROBE3(file_close, inFileName.c_str(), stats.bytesIn, stats.bytesOut);
+            if (out->fail()) {
+                error=BAD_OUTPUT;
+            }
+        }
         delete out;
         out=nullptr;
     }
@@ -279,12 +411,28 @@ ParseError CodeGenerator::generateFile (const string &inFileName,
 
 string CodeGenerator::generateString(const string &input)
 {
-    in = new istringstream (input);
-    out = new ostringstream ();
+    string result;
+    generateAppend(input, result);
+    return result;
+}
 
-    if ( in->fail() || out->fail()) {
-        return "";
-    }
+void CodeGenerator::generate(std::string_view input, string& output)
+{
+    output.clear();
+    generateAppend(input, output);
+}
+
+void CodeGenerator::generateAppend(std::string_view input, string& output)
+{
+    // the art parsers and file type checks read the stream, text is read from memory
+    ViewStreamBuf inputBuf(input);
+    std::istream inputStream(&inputBuf);
+    in = &inputStream;
+    memoryInput = input;
+
+    StringOutputSink sink(output);
+    out = &sink;
+    beginStats();
 
     if (! fragmentOutput) {
         *out << getHeader();
@@ -296,38 +444,45 @@ string CodeGenerator::generateString(const string &input)
         *out << getFooter();
     }
 
-    string result = static_cast<ostringstream*>(out)->str();
-
-    delete out;
+    sink.flush();
+    endStats();
     out=nullptr;
-    delete in;
     in=nullptr;
-
-    return result;
+    memoryInput = std::string_view();
 }
 
 string CodeGenerator::generateStringFromFile(const string &inFileName)
 {
 
     in = new ifstream (inFileName.c_str() , std::ios::binary);
-    out = new ostringstream ();
-
-    if ( in->fail() || out->fail()) {
+    if ( in->fail() ) {
+        delete in;
+        in=nullptr;
         return "";
     }
 
+    string result;
+    out = new StringOutputSink (result);
+
+    if (useMemoryMapping && !readAfterEOF) {
+        mappedInput.map(inFileName);
+    }
+    beginStats();
+
     if (! fragmentOutput) {
         *out << getHeader();
     }
 
     printBody();
 
+    mappedInput.unmap();
+
     if (! fragmentOutput) {
         *out << getFooter();
     }
 
-    string result = static_cast<ostringstream*>(out)->str();
-
+    out->flush();
+    endStats();
     delete out;
     out=nullptr;
     delete in;
@@ -336,6 +491,105 @@ string CodeGenerator::generateStringFromFile(const string &inFileName)
     return result;
 }
 
+ParseError CodeGenerator::begin(const string &outFileName)
+{
+    abandonPush();
+    pushOutput.reset(openOutput(outFileName));
+    out = pushOutput.get();
+    if ( !out ) {
+        return BAD_OUTPUT;
+    }
+    beginPush();
+    return PARSE_OK;
+}
+
+void CodeGenerator::begin(CallbackOutputSink::Callback callback)
+{
+    abandonPush();
+    pushOutput.reset(new CallbackOutputSink (callback, outputBufferSize));
+    out = pushOutput.get();
+    beginPush();
+}
+
+void CodeGenerator::abandonPush()
+{
+    if (pushOutput) {
+        pushOutput->discard();
+        pushOutput.reset();
+        out=nullptr;
+    }
+}
+
+void CodeGenerator::beginPush()
+{
+    beginStats();
+
+    if (! fragmentOutput) {
+        *out << getHeader();
+    }
+
+    printBodyBegin();
+
+    resetInputState();
+    tagOpen=false;
+    lineNumber=0;
+    lineReader.beginPush();
+    resetLineState();
+
+    if (parseCP437){
+        allocateTermBuffer();
+    }
+}
+
+bool CodeGenerator::feed(const char* data, size_t size)
+{
+    if (!out) {
+        return false;
+    }
+
+    // the reader buffers up to one block, convert it before pushing more
+    do {
+        size_t cnt = lineReader.push(data, size);
+        data += cnt;
+        size -= cnt;
+        processLines(false, nullptr);
+    } while (size);
+
+    out->flush();
+    return !out->fail();
+}
+
+ParseError CodeGenerator::finish()
+{
+    if (!out) {
+        return BAD_OUTPUT;
+    }
+
+    // there is nothing to wait for
+    bool follow = readAfterEOF;
+    readAfterEOF = false;
+    lineReader.finishPush();
+    processLines(true, nullptr);
+    readAfterEOF = follow;
+
+    if (parseCP437){
+        printTermBuffer();
+    }
+
+    printBodyEnd();
+
+    if (! fragmentOutput) {
+        *out << getFooter();
+    }
+
+    out->flush();
+    endStats();
+    ParseError error = out->fail() ? BAD_OUTPUT : PARSE_OK;
+    pushOutput.reset();
+    out=nullptr;
+    return error;
+}
+
 ParseError CodeGenerator::generateFileFromString (const string &sourceStr,
         const string &outFileName,
         const string &title)
@@ -344,8 +598,8 @@ ParseError CodeGenerator::generateFileFromString (const string &sourceStr,
 
     in = new istringstream (sourceStr);
     if (!in->fail()) {
-        out = (outFileName.empty()? &cout :new ofstream (outFileName.c_str()));
-        if ( out->fail()) {
+        out = openOutput(outFileName);
+        if ( !out ) {
             error=BAD_OUTPUT;
         }
     }
@@ -356,6 +610,8 @@ ParseError CodeGenerator::generateFileFromString (const string &sourceStr,
 
     if (error==PARSE_OK) {
 
+        beginStats();
+
         if (! fragmentOutput) {
             *out << getHeader();
         }
@@ -367,7 +623,14 @@ ParseError CodeGenerator::generateFileFromString (const string &sourceStr,
         }
     }
 
-    if (!outFileName.empty()) {
+    if (out) {
+        out->flush();
+        if (error==PARSE_OK) {
+            endStats();
+            if (out->fail()) {
+                error=BAD_OUTPUT;
+            }
+        }
         delete out;
         out=nullptr;
     }
@@ -392,8 +655,76 @@ bool CodeGenerator::printDynamicStyleFile ( const string &outPath )
  ESC[n;ny     Output char translate                   (NANSI)
  */
 
-bool CodeGenerator::parseSGRParameters(const string& line, size_t begin, size_t end)
+/** Get the next ';' separated SGR parameter. Empty parameters are skipped,
+    except for a trailing one.
+    \param codes parameter string
+    \param pos current position, updated
+    \param param receives the parameter
+    \return false if there are no more parameters */
+static bool nextSGRParameter(std::string_view codes, size_t& pos, std::string_view& param)
+{
+    while (pos<=codes.size()) {
+        size_t delim = codes.find(';', pos);
+        if (delim==std::string_view::npos) {
+            param = codes.substr(pos);
+            pos = codes.size()+1;
+            return true;
+        }
+        param = codes.substr(pos, delim-pos);
+        pos = delim+1;
+        if (!param.empty()) return true;
+    }
+    return false;
+}
+
+/** Read the leading number of a SGR parameter, like istream::operator>> does:
+    value is kept if the parameter is blank, set to 0 if it is not a number
+    and clamped on overflow.
+    \param param parameter string
+    \param value receives the number */
+static void parseSGRNumber(std::string_view param, int& value)
 {
+    const char* first = param.data();
+    const char* last = param.data() + param.size();
+
+    while (first<last && isspace((unsigned char)*first)) ++first;
+    if (first==last) return;
+
+    bool negative = *first=='-';
+    if (*first=='+' && first+1<last && *(first+1)!='-') ++first;
+
+    auto result = std::from_chars(first, last, value);
+    if (result.ec==std::errc::invalid_argument) {
+        value = 0;
+    } else if (result.ec==std::errc::result_out_of_range) {
+        value = negative ? std::numeric_limits<int>::min() : std::numeric_limits<int>::max();
+    }
+}
+
+/** Split a SGR parameter into its ':' separated sub parameters, empty sub
+    parameters are 0
+    \param param parameter string
+    \param values receives up to maxSGRSubParams numbers
+    \return number of sub parameters */
+static size_t parseSGRSubParameters(std::string_view param, int* values)
+{
+    size_t count=0, pos=0;
+    while (count<maxSGRSubParams) {
+        size_t delim = param.find(':', pos);
+        std::string_view sub = param.substr(pos, delim==std::string_view::npos ? delim : delim-pos);
+        values[count] = 0;
+        std::from_chars(sub.data(), sub.data()+sub.size(), values[count]);
+        ++count;
+        if (delim==std::string_view::npos) break;
+        pos = delim+1;
+    }
+    return count;
+}
+
+bool CodeGenerator::parseSGRParameters(std::string_view line, size_t begin, size_t end)
+{
+    AF_PROBE2(sgr_parse, line.data()+begin, end-begin);
+
     if (line.empty() || begin==end) { // fix empty grep --color ending sequence
       elementStyle.setReset(true);
       return true;
@@ -402,13 +733,14 @@ bool CodeGenerator::parseSGRParameters(const string& line, size_t begin, size_t
     int ansiCode=0;
     int colorCode=0;
     unsigned char colorValues[3]= {0};
+    int subParams[maxSGRSubParams];
 
-    string codes=line.substr(begin, end-begin);
-    vector<string> codeVector = StringTools::splitString(codes, ';');
+    std::string_view codes(line.substr(begin, end-begin));
+    std::string_view param;
+    size_t pos=0;
 
-    auto itVectorData = codeVector.begin();
-    while( itVectorData != codeVector.end()) {
-        StringTools::str2num<int>(ansiCode, *(itVectorData), std::dec);
+    while (nextSGRParameter(codes, pos, param)) {
+        parseSGRNumber(param, ansiCode);
         elementStyle.setReset(false);
 
         switch (ansiCode) {
@@ -417,7 +749,7 @@ bool CodeGenerator::parseSGRParameters(const string& line, size_t begin, size_t
             break;
         case 1:
             elementStyle.setBold(true);
-            elementStyle.setFgColour(rgb2html(workingPalette[8]));
+            elementStyle.setFgColour(StyleColour(workingPalette[8]));
             break;
         case 2: //Faint
             break;
@@ -473,41 +805,52 @@ bool CodeGenerator::parseSGRParameters(const string& line, size_t begin, size_t
         case 36:
         case 37:
             if (elementStyle.isBold()){
-              elementStyle.setFgColour(rgb2html(workingPalette[ansiCode-30+8]));
+              elementStyle.setFgColour(StyleColour(workingPalette[ansiCode-30+8]));
             } else
-              elementStyle.setFgColour(rgb2html(workingPalette[ansiCode-30]));
+              elementStyle.setFgColour(StyleColour(workingPalette[ansiCode-30]));
             break;
 
         case 38: // xterm 256 foreground color mode \033[38;5;<color>
 
-            itVectorData++;
-            if (itVectorData == codeVector.end()) break;
+            // ITU T.416 sub parameters: 38:5:<n>, 38:2:<colour space id>:<r>:<g>:<b> or 38:2:<r>:<g>:<b>
+            if (param.find(':')!=std::string_view::npos) {
+                size_t subCount = parseSGRSubParameters(param, subParams);
+                if (subCount>=3 && subParams[1]==5) {
+                    xterm2rgb((unsigned char)subParams[2], colorValues);
+                    elementStyle.setFgColour(StyleColour(colorValues));
+                } else if (subCount>=5 && subParams[1]==2) {
+                    size_t rgbIdx = subCount>=6 ? 3 : 2;
+                    colorValues[0] = subParams[rgbIdx] & 0xff;
+                    colorValues[1] = subParams[rgbIdx+1] & 0xff;
+                    colorValues[2] = subParams[rgbIdx+2] & 0xff;
+                    elementStyle.setFgColour(StyleColour(colorValues));
+                }
+                break;
+            }
 
-            if (*(itVectorData)=="5") {
-                itVectorData++;
-                if (itVectorData == codeVector.end()) break;
+            if (!nextSGRParameter(codes, pos, param)) break;
 
-                StringTools::str2num<int>(colorCode, *(itVectorData), std::dec);
+            if (param=="5") {
+                if (!nextSGRParameter(codes, pos, param)) break;
+
+                parseSGRNumber(param, colorCode);
                 xterm2rgb((unsigned char)colorCode, colorValues);
-                elementStyle.setFgColour(rgb2html(colorValues));
-            } else if (*(itVectorData)=="2") {
+                elementStyle.setFgColour(StyleColour(colorValues));
+            } else if (param=="2") {
 
-                itVectorData++;
-                if (itVectorData == codeVector.end()) break;
-                StringTools::str2num<int>(colorCode, *(itVectorData), std::dec);
+                if (!nextSGRParameter(codes, pos, param)) break;
+                parseSGRNumber(param, colorCode);
                 colorValues[0] = colorCode & 0xff;
-                itVectorData++;
 
-                if (itVectorData == codeVector.end()) break;
-                StringTools::str2num<int>(colorCode, *(itVectorData), std::dec);
+                if (!nextSGRParameter(codes, pos, param)) break;
+                parseSGRNumber(param, colorCode);
                 colorValues[1] = colorCode & 0xff;
 
-                itVectorData++;
-                if (itVectorData == codeVector.end()) break;
-                StringTools::str2num<int>(colorCode, *(itVectorData), std::dec);
+                if (!nextSGRParameter(codes, pos, param)) break;
+                parseSGRNumber(param, colorCode);
                 colorValues[2] = colorCode & 0xff;
 
-                elementStyle.setFgColour(rgb2html(colorValues));
+                elementStyle.setFgColour(StyleColour(colorValues));
             }
             break;
 
@@ -523,40 +866,50 @@ bool CodeGenerator::parseSGRParameters(const string& line, size_t begin, size_t
         case 45:
         case 46:
         case 47:
-            elementStyle.setBgColour(rgb2html(workingPalette[ansiCode-40]));
+            elementStyle.setBgColour(StyleColour(workingPalette[ansiCode-40]));
             break;
 
         case 48:  // xterm 256 background color mode \033[48;5;<color>
 
-            itVectorData++;
-            if (itVectorData == codeVector.end()) break;
+            // ITU T.416 sub parameters: 38:5:<n>, 38:2:<colour space id>:<r>:<g>:<b> or 38:2:<r>:<g>:<b>
+            if (param.find(':')!=std::string_view::npos) {
+                size_t subCount = parseSGRSubParameters(param, subParams);
+                if (subCount>=3 && subParams[1]==5) {
+                    xterm2rgb((unsigned char)subParams[2], colorValues);
+                    elementStyle.setBgColour(StyleColour(colorValues));
+                } else if (subCount>=5 && subParams[1]==2) {
+                    size_t rgbIdx = subCount>=6 ? 3 : 2;
+                    colorValues[0] = subParams[rgbIdx] & 0xff;
+                    colorValues[1] = subParams[rgbIdx+1] & 0xff;
+                    colorValues[2] = subParams[rgbIdx+2] & 0xff;
+                    elementStyle.setBgColour(StyleColour(colorValues));
+                }
+                break;
+            }
 
-            if(*(itVectorData)=="5") {
+            if (!nextSGRParameter(codes, pos, param)) break;
 
-                itVectorData++;
-                if (itVectorData == codeVector.end()) break;
+            if (param=="5") {
+                if (!nextSGRParameter(codes, pos, param)) break;
 
-                StringTools::str2num<int>(colorCode, *(itVectorData), std::dec);
+                parseSGRNumber(param, colorCode);
                 xterm2rgb((unsigned char)colorCode, colorValues);
-                elementStyle.setBgColour(rgb2html(colorValues));
-            } else if (*(itVectorData)=="2") {
+                elementStyle.setBgColour(StyleColour(colorValues));
+            } else if (param=="2") {
 
-                itVectorData++;
-                if (itVectorData == codeVector.end()) break;
-                StringTools::str2num<int>(colorCode, *(itVectorData), std::dec);
+                if (!nextSGRParameter(codes, pos, param)) break;
+                parseSGRNumber(param, colorCode);
                 colorValues[0] = colorCode & 0xff;
-                itVectorData++;
 
-                if (itVectorData == codeVector.end()) break;
-                StringTools::str2num<int>(colorCode, *(itVectorData), std::dec);
+                if (!nextSGRParameter(codes, pos, param)) break;
+                parseSGRNumber(param, colorCode);
                 colorValues[1] = colorCode & 0xff;
 
-                itVectorData++;
-                if (itVectorData == codeVector.end()) break;
-                StringTools::str2num<int>(colorCode, *(itVectorData), std::dec);
+                if (!nextSGRParameter(codes, pos, param)) break;
+                parseSGRNumber(param, colorCode);
                 colorValues[2] = colorCode & 0xff;
 
-                elementStyle.setBgColour(rgb2html(colorValues));
+                elementStyle.setBgColour(StyleColour(colorValues));
             }
 
             break;
@@ -574,7 +927,7 @@ bool CodeGenerator::parseSGRParameters(const string& line, size_t begin, size_t
         case 95:
         case 96:
         case 97:
-            elementStyle.setFgColour(rgb2html(workingPalette[ansiCode-90+8]));
+            elementStyle.setFgColour(StyleColour(workingPalette[ansiCode-90+8]));
             break;
 
         case 100:
@@ -585,7 +938,7 @@ bool CodeGenerator::parseSGRParameters(const string& line, size_t begin, size_t
         case 105:
         case 106:
         case 107:
-            elementStyle.setBgColour(rgb2html(workingPalette[ansiCode-100+8]));
+            elementStyle.setBgColour(StyleColour(workingPalette[ansiCode-100+8]));
             break;
         }
 
@@ -600,20 +953,20 @@ bool CodeGenerator::parseSGRParameters(const string& line, size_t begin, size_t
           elementStyle.setBgColourID(ansiCode-40 /*+ elementStyle.isBold()? 8 : 0 */);
         else if (ansiCode>=100 and ansiCode <108)
           elementStyle.setBgColourID(ansiCode-100+8);
-
-        if (itVectorData != codeVector.end()) itVectorData++;
     }
 
     return true;
 }
 
 
-void CodeGenerator::parseCodePage437Seq(string line, size_t begin, size_t end){
+void CodeGenerator::parseCodePage437Seq(std::string_view line, size_t begin, size_t end){
 
-  string codes=line.substr(begin, end-begin);
+  string codes(line.substr(begin, end-begin));
   vector<string> codeVector = StringTools::splitString(codes, ',');
 
-  if (line[end]=='H'){
+  const char seqType = end<line.size() ? line[end] : '\0';
+
+  if (seqType=='H'){
     codeVector = StringTools::splitString(codes, ';');
 
     curX = curY = 0;
@@ -627,7 +980,7 @@ void CodeGenerator::parseCodePage437Seq(string line, size_t begin, size_t end){
     if (maxY<curY && curY<asciiArtHeight) maxY=curY;
   }
 
-  if (line[end]=='A'){
+  if (seqType=='A'){
     if (codeVector.size()==1){
       curY -= atoi(codeVector[0].c_str());
      } else {
@@ -635,7 +988,7 @@ void CodeGenerator::parseCodePage437Seq(string line, size_t begin, size_t end){
     }
   }
 
-  if (line[end]=='B'){
+  if (seqType=='B'){
     if (codeVector.size()==1){
       curY += atoi(codeVector[0].c_str());
     } else {
@@ -644,7 +997,7 @@ void CodeGenerator::parseCodePage437Seq(string line, size_t begin, size_t end){
     if (maxY<curY && curY<asciiArtHeight) maxY=curY;
   }
 
-  if (line[end]=='C'){
+  if (seqType=='C'){
 
     if (codeVector.size()==1){
       curX += atoi(codeVector[0].c_str());
@@ -660,7 +1013,7 @@ void CodeGenerator::parseCodePage437Seq(string line, size_t begin, size_t end){
     }
   }
 
-  if (line[end]=='D'){
+  if (seqType=='D'){
     if (codeVector.size()==1){
       curX -= atoi(codeVector[0].c_str());
      } else {
@@ -669,7 +1022,7 @@ void CodeGenerator::parseCodePage437Seq(string line, size_t begin, size_t end){
     if (curX<0) curX=0;
   }
 
-  if (line[end]=='J'){
+  if (seqType=='J'){
  //   std::cerr<<"J!!!\n";
     /*
     if (codeVector.size()==1 && codeVector[0]=="2"){
@@ -678,18 +1031,18 @@ void CodeGenerator::parseCodePage437Seq(string line, size_t begin, size_t end){
     */
   }
 
-  if (line[end]=='K'){
+  if (seqType=='K'){
   //  std::cerr<<"K!!!\n";
     //    for (int i=curX;i<asciiArtWidth;i++) termBuffer[curY*asciiArtWidth + i]->c =0;
 
   }
 
-  if (line[end]=='s'){
+  if (seqType=='s'){
     memX = curX;
     memY = curY;
     memStyle = elementStyle;
   }
-  if (line[end]=='u'){
+  if (seqType=='u'){
     curX = memX;
     curY = memY;
     elementStyle=memStyle;
@@ -699,50 +1052,70 @@ void CodeGenerator::parseCodePage437Seq(string line, size_t begin, size_t end){
 
 void CodeGenerator::insertLineNumber ()
 {
-    if ( showLineNumbers && !parseCP437) {
-
-        ostringstream lnum;
-        lnum << setw ( 5 ) << right;
-        if( numberCurrentLine ) {
-            *out << getCloseTag();
-            lnum << lineNumber;
-            *out <<lnum.str()<<spacer;
-            *out << getOpenTag();
-        } else {
-            *out << lnum.str(); //for indentation
-        }
+    if ( showLineNumbers && !parseCP437 && numberCurrentLine) {
+        *out << closeTag();
+        *out << formatLineNumber() << spacer;
+        *out << openTag();
     }
 }
 
+string CodeGenerator::formatLineNumber() const
+{
+    char digits[16];
+    auto result = std::to_chars(digits, digits+sizeof(digits), lineNumber);
+    size_t len = result.ptr-digits;
+    string field(len<lineNumberWidth ? lineNumberWidth-len : 0, ' ');
+    field.append(digits, len);
+    return field;
+}
+
 void CodeGenerator::printTermBuffer() {
 
     for (unsigned int y=0;y<=maxY;y++) {
 
+        // cells with the same style index share one open and close tag
+        bool runOpen = false;
+        bool runTagged = false;
+        uint16_t runStyle = 0;
+        bool runFullBlock = false;
+
         for (unsigned int x=0;x<asciiArtWidth;x++) {
-            if (termBuffer[x + y* asciiArtWidth].c=='\r') {
+            const TDChar& cell = termBuffer[x + y* asciiArtWidth];
+            if (cell.c=='\r') {
                 break;
             }
-            elementStyle = termBuffer[x + y* asciiArtWidth].style;
+            bool fullBlock = cell.c == 0xdb;
 
-            //full block
-            if (termBuffer[x + y* asciiArtWidth].c == 0xdb){
-                elementStyle.setBgColour(elementStyle.getFgColour());
-            }
-
-            if (!elementStyle.isReset()) {
-                *out <<getOpenTag();
-            }
+            if (!runOpen || cell.style != runStyle || fullBlock != runFullBlock) {
+                if (runTagged) {
+                    *out <<closeTag();
+                }
+                elementStyle = termStyles[cell.style];
 
-            *out << maskCP437Character(termBuffer[x + y* asciiArtWidth].c);
+                //full block
+                if (fullBlock){
+                    elementStyle.setBgColour(elementStyle.getFgColour());
+                }
 
-            if (!elementStyle.isReset()) {
-                *out <<getCloseTag();
+                runTagged = !elementStyle.isReset();
+                if (runTagged) {
+                    *out <<openTag();
+                }
+                runOpen = true;
+                runStyle = cell.style;
+                runFullBlock = fullBlock;
             }
+
+            *out << maskCP437Character(cell.c);
+        }
+        if (runTagged) {
+            *out <<closeTag();
         }
     *out<<newLineTag;
   }
   out->flush();
   delete [] termBuffer;
+  termBuffer = nullptr;
 }
 
 
@@ -765,15 +1138,15 @@ void CodeGenerator::parseBinFile(){
       colBg -= 8;
     }
 
-    elementStyle.setFgColour(rgb2html(workingPalette[colFg]));
-    elementStyle.setBgColour(rgb2html(workingPalette[colBg]));
+    elementStyle.setFgColour(StyleColour(workingPalette[colFg]));
+    elementStyle.setBgColour(StyleColour(workingPalette[colBg]));
 
     //FIXME:
     elementStyle.setBold(cur >= 0x20 && cur <= 0x7a);
 
     if (curX>=0 && curX<asciiArtWidth && curY>=0 && curY<asciiArtHeight){
       termBuffer[curX + curY*asciiArtWidth].c = cur;
-      termBuffer[curX + curY*asciiArtWidth].style = elementStyle;
+      termBuffer[curX + curY*asciiArtWidth].style = internTermStyle(elementStyle);
       curX++;
     }
     if (count % asciiArtWidth == 0 ) {
@@ -877,15 +1250,15 @@ void CodeGenerator::parseXBinFile(){
               colBg -= 8;
             }
 
-            elementStyle.setFgColour(rgb2html(workingPalette[colFg]));
-            elementStyle.setBgColour(rgb2html(workingPalette[colBg]));
+            elementStyle.setFgColour(StyleColour(workingPalette[colFg]));
+            elementStyle.setBgColour(StyleColour(workingPalette[colBg]));
 
             //FIXME:
             elementStyle.setBold(cur >= 0x20 && cur <= 0x7a);
 
             if (curX>=0 && curX<asciiArtWidth && curY>=0 && curY<asciiArtHeight){
               termBuffer[curX + curY*asciiArtWidth].c = cur;
-              termBuffer[curX + curY*asciiArtWidth].style = elementStyle;
+              termBuffer[curX + curY*asciiArtWidth].style = internTermStyle(elementStyle);
               curX++;
             }
 
@@ -976,10 +1349,10 @@ void CodeGenerator::parseTundraFile(){
 
         if (cur !=1 && cur !=2 && cur !=4 && cur !=6)
         {
-            elementStyle.setFgColour(rgb2html( fg_red&0xff, fg_green&0xff, fg_blue&0xff));
-            elementStyle.setBgColour(rgb2html( bg_red&0xff, bg_green&0xff, bg_blue&0xff ));
+            elementStyle.setFgColour(StyleColour( fg_red&0xff, fg_green&0xff, fg_blue&0xff));
+            elementStyle.setBgColour(StyleColour( bg_red&0xff, bg_green&0xff, bg_blue&0xff ));
 
-            termBuffer[curX + curY*asciiArtWidth].style = elementStyle;
+            termBuffer[curX + curY*asciiArtWidth].style = internTermStyle(elementStyle);
 
             termBuffer[curX + curY*asciiArtWidth].c  = cur &0xff;
             curX++;
@@ -998,7 +1371,31 @@ void CodeGenerator::allocateTermBuffer(){
   termBuffer = new TDChar[asciiArtWidth*asciiArtHeight];
   for (unsigned int i=0; i<asciiArtWidth*asciiArtHeight; i++){
     termBuffer[i].c=0;
+    termBuffer[i].style=0;
   }
+  termStyles.assign(1, ElementStyle());
+  termStyleIndex.clear();
+  termStyleIndex.emplace(termStyles[0], 0);
+  lastTermStyle = 0;
+  curX = curY = memX = memY = maxY = 0;
+}
+
+uint16_t CodeGenerator::internTermStyle(const ElementStyle& style){
+
+  // consecutive cells mostly share their style
+  if (termStyles[lastTermStyle] == style) return lastTermStyle;
+
+  auto it = termStyleIndex.find(style);
+  if (it != termStyleIndex.end()) {
+    lastTermStyle = it->second;
+  } else if (termStyles.size() <= UINT16_MAX) {
+    lastTermStyle = (uint16_t)termStyles.size();
+    termStyles.push_back(style);
+    termStyleIndex.emplace(style, lastTermStyle);
+  } else {
+    return 0;
+  }
+  return lastTermStyle;
 }
 
 bool CodeGenerator::streamIsXBIN() {
@@ -1030,14 +1427,53 @@ bool CodeGenerator::streamIsTundra() {
 }
 ////////////////////////////////////////////////////////////////////////////
 
-void CodeGenerator::processInput()
+/** \return character at position i or '\0' if i is out of range */
+static inline char charAt(std::string_view line, size_t i)
 {
-  int cur=0;
-  int next=0;
+    return i<line.size() ? line[i] : '\0';
+}
+
+/** Determine where to split a segment of an overlong line. The segment is cut
+    before the last escape sequence introducer or control character near its end,
+    which is then parsed together with the following input block.
+    @param segment line segment
+    @return length of the part which may be parsed now */
+static size_t getSegmentCutPos(std::string_view segment)
+{
+    // max. length of escape sequences which are not split
+    const size_t maxSeqLen = 4096;
+    size_t limit = segment.size() > maxSeqLen ? segment.size() - maxSeqLen : 0;
+
+    for (size_t pos = segment.size(); pos > limit; --pos) {
+        unsigned char c = segment[pos-1];
+        if (c==0x1b || c==0xc2 || c==0x0d || (c>=0x90 && c<=0x9f)) {
+            return pos-1;
+        }
+        // backspace deletes the preceding character
+        if (c==0x08) {
+            return pos>1 ? pos-2 : 0;
+        }
+    }
+    return segment.size();
+}
+
+void CodeGenerator::resetInputState()
+{
+  // formatting and output of the previous input must not leak into this one
+  lineBuf.clear();
+  elementStyle = initialStyle;
+  memStyle = initialStyle;
+  asciiArtWidth = artWidthOption;
+  asciiArtHeight = artHeightOption;
 
   if (parseCP437 || parseAsciiBin || parseAsciiTundra){
     elementStyle.setReset(false);
   }
+}
+
+void CodeGenerator::processInput()
+{
+  resetInputState();
 
   // deal with BIN/XBIN without file watching, reformatting and line numbering distractions
   if (parseAsciiBin){
@@ -1048,6 +1484,10 @@ void CodeGenerator::processInput()
       parseBinFile();
 
     printTermBuffer();
+    AF_ADD(bytesIn, mappedInput.getSize() + memoryInput.size());
+
+    // an XBIN palette only applies to its own file
+    memcpy(workingPalette, colorMapPalette, sizeof colorMapPalette);
     return;
   }
 
@@ -1055,14 +1495,32 @@ void CodeGenerator::processInput()
     parseTundraFile();
 
     printTermBuffer();
+    AF_ADD(bytesIn, mappedInput.getSize() + memoryInput.size());
     return;
   }
 
 
   // handle normal text files
-  if (readAfterEOF && in!=&cin) {
+  if (streamIsXBIN()) {
+   *out<<"Please apply --art-bin option for XBIN files.\n";
+   return;
+  }
+
+  if (streamIsTundra()) {
+   *out<<"Please apply --art-tundra option for TND files.\n";
+   return;
+  }
+
+  tagOpen=false;
+  lineNumber=0;
+
+  // output the last few lines or the complete file if not too big
+  if (followedInput.getDescriptor()>=0 && tailLines) {
+    recoverTailStyle(followedInput.seekTailLines(*tailLines));
+  } else if (followedInput.getDescriptor()>=0) {
+    followedInput.seekTail(51200, 512);
+  } else if (readAfterEOF && in!=&cin) {
     in->seekg (0, ios::end);
-    // output the last few lines or the complete file if not too big
     if (in->tellg()>51200) {
       in->seekg (-512, ios::end);
       // output complete lines, ignore cur line fragment
@@ -1072,58 +1530,256 @@ void CodeGenerator::processInput()
     }
   }
 
-  if (streamIsXBIN()) {
-   *out<<"Please apply --art-bin option for XBIN files.\n";
-   return;
+  if (mappedInput.getData()) {
+    lineReader.setMemory(mappedInput.getData(), mappedInput.getSize());
+    AF_ADD(bytesIn, mappedInput.getSize());
+  } else if (memoryInput.data()) {
+    lineReader.setMemory(memoryInput.data(), memoryInput.size());
+    AF_ADD(bytesIn, memoryInput.size());
   }
+  else if (followedInput.getDescriptor()>=0)
+    lineReader.setFileDescriptor(followedInput.getDescriptor());
+  else if (in==&cin)
+    lineReader.setFileDescriptor(0);
+  else
+    lineReader.setStream(in);
+  lineReader.tie(out);
+  resetLineState();
 
-  if (streamIsTundra()) {
-   *out<<"Please apply --art-tundra option for TND files.\n";
-   return;
+  if (parseCP437){
+    allocateTermBuffer();
   }
 
-  string line;
-  size_t i=0;
-  size_t plainTxtCnt=0;
-  bool tagOpen=false;
+  // the RTF UTF-8 decoder keeps state between characters, which the pre-scan does not follow
+  if (!chunkWorkers.empty() && !parseCP437 && outputType!=RTF
+      && mappedInput.getSize() >= 2*chunkSize) {
+    processChunks();
+  } else {
+    processLines(true, nullptr);
+  }
 
-  bool isGrepOutput=false;
-  bool isKSeq=false;
+  if (parseCP437){
+    printTermBuffer();
+  }
+  lineReader.tie(nullptr);
+  out->flush();
+}
 
-  bool omitNewLine=false;
-  lineNumber=0;
+void CodeGenerator::recoverTailStyle(off_t start)
+{
+  // the term buffer of ANSI art is not restored
+  if (parseCP437 || ignoreFormatting || start==0)
+    return;
 
-  if (parseCP437){
-    allocateTermBuffer();
+  // replay the skipped input from the last SGR reset (ESC[m, ESC[0m, ESC[0;...m)
+  const off_t maxScanSize = 1024*1024;
+  off_t scanBegin = start > maxScanSize ? start-maxScanSize : 0;
+  string skipped;
+  if (!followedInput.readAt(scanBegin, start-scanBegin, skipped))
+    return;
+
+  size_t replayBegin = 0;
+  for (size_t pos = skipped.rfind("\033["); pos != string::npos;
+       pos = pos ? skipped.rfind("\033[", pos-1) : string::npos) {
+    size_t param = pos+2;
+    while (param < skipped.size() && skipped[param]=='0')
+      ++param;
+    if (param < skipped.size() && (skipped[param]=='m' || skipped[param]==';')) {
+      replayBegin = pos;
+      break;
+    }
   }
 
-  while (true) {
+  bool follow = readAfterEOF;
+  OutputSink* target = out;
+  NullOutputSink discard;
+  ConversionStats counted = stats;
+  readAfterEOF = false;
+  out = &discard;
+  scanOnly = true;
+  lineReader.setMemory(skipped.data()+replayBegin, skipped.size()-replayBegin);
+  resetLineState();
+  processLines(true, nullptr);
+  scanOnly = false;
+  out = target;
+  readAfterEOF = follow;
+  stats = counted;
+
+  lineBuf.clear();
+  lineNumber = 0;
+  tagOpen = false;
+
+  // the first line continues the formatting of the skipped one
+  if (!elementStyle.isReset()) {
+    lineBuf << openTag();
+    tagOpen = true;
+  }
+}
 
-    bool eof=false;
+void CodeGenerator::flushCompleteLine()
+{
+  // a line which is continued or may still be overwritten by CR is kept
+  if (lineStart && !omitNewLine && lineBuf.getWritePosition()==lineBuf.view().size()) {
+    std::string_view content = lineBuf.view();
+    out->write(content.data(), content.size());
+    lineBuf.clear();
+  }
+}
 
-    eof=!getline(*in, line);
+void CodeGenerator::waitForInput()
+{
+  // show the current line before waiting
+  flushCompleteLine();
+  out->flush();
 
-    if( !omitNewLine )
-        ++lineNumber;
+  if (followedInput.getDescriptor()>=0) {
+    // the file was rotated or truncated
+    bool reopened = followedInput.waitForData();
+    if (reopened)
+      lineReader.setFileDescriptor(followedInput.getDescriptor());
+    AF_PROBE1(tail_wakeup, reopened ? 1 : 0);
+  } else {
+    in->clear();
+    #ifdef WIN32
+    Sleep(250);
+    #else
+    sleep(1);
+    #endif
+    AF_PROBE1(tail_wakeup, 0);
+  }
+  lineReader.clearEOF();
+}
 
-    numberCurrentLine = true;
+struct CodeGenerator::ChunkQueue {
+  std::mutex mutex;
+  std::condition_variable changed;
+  vector<ChunkState> states;  ///< chunk boundaries found so far
+  size_t nextOffset = 0;      ///< minimum offset of the next boundary
+  size_t size = 0;            ///< chunk size
+  size_t inputSize = 0;       ///< size of the complete input
+  size_t maxPending = 0;      ///< boundaries which may be scanned ahead of the output
+  size_t nextChunk = 0;       ///< next chunk to render
+  size_t written = 0;         ///< number of chunks written to the output
+  bool complete = false;      ///< the pre-scan reached the end of input
+
+  /** called by the pre-scan at every possible chunk start */
+  void scanned(const ChunkState& state)
+  {
+    if (state.offset<nextOffset || state.offset>=inputSize) return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    // limit the scanned, but not yet released part of the mapped input
+    changed.wait(lock, [this] { return states.size() < written + maxPending; });
+    states.push_back(state);
+    nextOffset = state.offset + size;
+    lock.unlock();
+    changed.notify_all();
+  }
+
+  void finish()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    complete = true;
+    changed.notify_all();
+  }
+};
+
+void CodeGenerator::beginStats()
+{
+  stats = ConversionStats();
+  seenStyles.clear();
+  statsReadBase = lineReader.getBytesRead();
+
+  if (AF_STATS_ENABLED && collectStats) {
+    statsWallStart = ConversionStats::wallClock();
+    statsCpuStart = ConversionStats::cpuClock(false);
+    lineReader.setReadTimer(&stats.read);
+    out->setWriteTimer(&stats.write);
+  }
+}
+
+void CodeGenerator::endStats()
+{
+  if (!AF_STATS_ENABLED)
+    return;
+
+  // the output has been flushed
+  stats.bytesIn += lineReader.getBytesRead() - statsReadBase;
+  stats.bytesOut = out->getBytesWritten();
+  stats.distinctStyles = seenStyles.size();
+  seenStyles.clear();
+
+  if (collectStats) {
+    lineReader.setReadTimer(nullptr);
+    out->setWriteTimer(nullptr);
+    stats.total.wall = ConversionStats::wallClock() - statsWallStart;
+    stats.total.cpu = ConversionStats::cpuClock(false) - statsCpuStart;
+    stats.render.wall = std::max(0.0, stats.total.wall - stats.read.wall - stats.write.wall);
+    stats.render.cpu = std::max(0.0, stats.total.cpu - stats.read.cpu - stats.write.cpu);
+  }
+}
+
+void CodeGenerator::resetLineState()
+{
+  lineStart=true;
+  plainTxtCnt=0;
+  lineOffset=0;
+  omitNewLine=false;
+  skipLineRest=false;
+}
+
+void CodeGenerator::processLines(bool lastChunk, ChunkQueue* chunks)
+{
+  std::string_view line;
+  bool lineEnd=true;
+
+  while (true) {
+
+    // the rest of a truncated input file reads as zeros
+    if (mappedInput.isTruncated()) {
+      break;
+    }
+
+    // a chunk may begin with any line which does not continue the previous output line
+    if (chunks && lineStart && !omitNewLine) {
+      chunks->scanned(ChunkState{lineReader.getMemoryOffset(), elementStyle, lineNumber, tagOpen, tagIsOpen});
+    }
+
+    bool eof=!lineReader.nextSegment(line, lineEnd);
 
     if (eof) {
       // imitate tail behaviour, continue to read after EOF
-      if (readAfterEOF) {
-        out->flush();
-        in->clear();
-        #ifdef WIN32
-        Sleep(250);
-        #else
-        sleep(1);
-        #endif
+      if (readAfterEOF && lastChunk) {
+        waitForInput();
       } else {
-        if (!parseCP437 && !omitTrailingCR)
-            printNewLine(outputType!=TEXT);
+        if (!lastChunk && lineReader.isPushed()) {
+          // the next feed() call may continue the line
+          flushCompleteLine();
+        } else if (!lastChunk) {
+          // the next chunk begins with the line break
+          std::string_view content = lineBuf.view();
+          out->write(content.data(), content.size());
+          lineBuf.clear();
+        } else if (!parseCP437) {
+          // the rest of the last line is printed even without line break
+          printNewLine(outputType!=TEXT, !omitTrailingCR);
+        }
         break;
       }
-    } else {
+      continue;
+    }
+
+    if (lineStart) {
+      AF_COUNT(lines);
+      if( !omitNewLine ) {
+        ++lineNumber;
+#ifdef ANSIFILTER_USDT
+        if (lineNumber % AF_PROBE_LINE_INTERVAL == 0)
+          AF_PROBE1(lines, (uint64_t)lineNumber);
+#endif
+      }
+
+      numberCurrentLine = true;
 
       if (!omitNewLine && !parseCP437 && lineNumber>1)
           printNewLine();
@@ -1133,247 +1789,419 @@ void CodeGenerator::processInput()
 
       omitNewLine = false;
 
-      i=0;
       plainTxtCnt=0;
-      size_t seqEnd=string::npos;
-
-      while (i <line.length() ) {
-        // CSI ?
-        cur = line[i]&0xff;
-
-        if (parseCP437){
-
-          if (cur==0x1b && line.length() - i > 2){
-            next = line[i+1]&0xff;
-            if (next==0x5b) {
-              i+=2;
-              seqEnd = i;
-              //find sequence end
-              while (   seqEnd<line.length()
-                && (line[seqEnd]<0x40 || line[seqEnd]>0x7e )) {
-                ++seqEnd;
-                }
+      lineOffset=0;
+      seqEnd=string::npos;
+      skipLineRest=false;
+    }
 
-                if ( line[seqEnd]=='m' ) {
-                  parseSGRParameters(line, i, seqEnd);
-                } else {
-                  parseCodePage437Seq(line, i, seqEnd);
-                }
-                i=seqEnd+1;
-            }
-            else {
-                ++i;
-            }
-          } else  if (cur==0x1a && line.length() - i > 6){
-            // skip SAUCE info section
-            while (line[i]==0x1a || !line[i]) ++i;
-            if (line.substr(i, 5)=="SAUCE"){
-              break;
-            }
-          } else {
-            if (curX>=0 && curX<asciiArtWidth && curY>=0 && curY<asciiArtHeight){
-              termBuffer[curX + curY*asciiArtWidth].c = line[i];
-              termBuffer[curX + curY*asciiArtWidth].style = elementStyle;
-              curX++;
-            }
+    if (!lineEnd) {
+      // parse sequences at the end of the segment together with the next block
+      size_t cutPos = getSegmentCutPos(line);
+      lineReader.keepTail(line.size()-cutPos);
+      line = line.substr(0, cutPos);
+    }
 
-            if (curX==asciiArtWidth || line[i]=='\r' ) {
-              curY++;
-              if (maxY<curY && curY<asciiArtHeight) maxY=curY;
-              curX=0;
-              if (line[i]=='\r') i=line.length();
-            }
-            ++i;
-          }
-        } else {
+    if (!skipLineRest) {
+      if (parseCP437)
+        parseCodePage437Segment(line);
+      else
+        parseLineSegment(line);
+    }
 
-          if ( (cur&0xff)==0x0d && i<line.length()-1) {
+    if (!lineEnd) {
+      lineOffset += line.size();
 
-            plainTxtCnt-=i;
+      // do not keep the output of overlong lines in memory
+      if (lineBuf.getWritePosition() > lineReader.getBlockSize()) {
+        std::string_view content = lineBuf.view();
+        out->write(content.data(), content.size());
+        lineBuf.clear();
+      }
+    }
 
-            lineBuf.seekp(showLineNumbers ? 0 : 0, ios::beg);
-            //lineBuf<<getOpenTag();
+    // the chunk workers still need the input which was pre-scanned
+    if (mappedInput.getData() && !chunks) {
+      mappedInput.release(lineReader.getMemoryOffset());
+    }
 
+    lineStart = lineEnd;
+  } // while (true)
+
+  if (tagOpen && lastChunk) {
+    *out <<closeTag();
+  }
+}
+
+void CodeGenerator::processChunks()
+{
+  const char* data = mappedInput.getData();
+  size_t inputSize = mappedInput.getSize();
+  OutputSink* target = out;
+
+  ChunkQueue chunks;
+  chunks.size = chunkSize;
+  chunks.inputSize = inputSize;
+  chunks.maxPending = chunkWorkers.size()+1;
+
+  auto render = [&](CodeGenerator* generator) {
+    string result;
+    while (true) {
+      std::unique_lock<std::mutex> lock(chunks.mutex);
+      size_t n = chunks.nextChunk++;
+      // the end of the chunk is known when the next one was found
+      chunks.changed.wait(lock, [&] { return chunks.states.size()>n+1 || chunks.complete; });
+      if (n>=chunks.states.size()) return;
+      ChunkState state = chunks.states[n];
+      bool lastChunk = n+1==chunks.states.size();
+      size_t end = lastChunk ? inputSize : chunks.states[n+1].offset;
+      lock.unlock();
+
+      result.clear();
+      generator->renderChunk(std::string_view(data+state.offset, end-state.offset), state, lastChunk, result);
+
+      lock.lock();
+      chunks.changed.wait(lock, [&] { return chunks.written==n; });
+      lock.unlock();
+
+      // it is this chunk's turn, no other worker writes now
+      target->write(result.data(), result.size());
+      mappedInput.release(end);
+
+      lock.lock();
+      ++chunks.written;
+      lock.unlock();
+      chunks.changed.notify_all();
+    }
+  };
+
+  vector<std::thread> workers;
+  for (auto generator: chunkWorkers) {
+    workers.emplace_back(render, generator);
+  }
+
+  // pre-scan in this thread, only the state changes are needed
+  NullOutputSink discard;
+  out = &discard;
+  scanOnly = true;
+  processLines(true, &chunks);
+  scanOnly = false;
+  out = target;
+
+  chunks.finish();
+  for (auto& t: workers) {
+    t.join();
+  }
+}
+
+void CodeGenerator::renderChunk(std::string_view chunk, const ChunkState& state, bool lastChunk, string& result)
+{
+  StringOutputSink sink(result);
+  out = &sink;
+
+  elementStyle = state.style;
+  tagOpen = state.tagOpen;
+  tagIsOpen = state.tagIsOpen;
+  lineNumber = state.lineNumber;
+  lineBuf.clear();
+
+  lineReader.setMemory(chunk.data(), chunk.size());
+  resetLineState();
+  processLines(lastChunk, nullptr);
+
+  sink.flush();
+  out = nullptr;
+}
+
+void CodeGenerator::parseCodePage437Segment(std::string_view line)
+{
+  size_t i=0;
+  int cur=0;
+  int next=0;
+
+  while (i <line.length() ) {
+    cur = line[i]&0xff;
+
+    if (cur==0x1b && line.length() - i > 2){
+      next = line[i+1]&0xff;
+      if (next==0x5b) {
+        i+=2;
+        seqEnd = i;
+        //find sequence end
+        while (   seqEnd<line.length()
+          && (line[seqEnd]<0x40 || line[seqEnd]>0x7e )) {
+          ++seqEnd;
           }
-            // wrap line
-          if (lineWrapLen && plainTxtCnt && plainTxtCnt % lineWrapLen==0) {
-              ++lineNumber;
-              printNewLine();
-              insertLineNumber();
-              plainTxtCnt=0;
-           }
-
-          if ( line.length() - i > 2 && (line[i+1]&0xff)==0x08) i++;
-          if ( cur==0x07) {
-              ++lineNumber;
-              printNewLine();
-              insertLineNumber();
+
+          if ( charAt(line, seqEnd)=='m' ) {
+            AF_COUNT(sgrSequences);
+            parseSGRParameters(line, i, seqEnd);
+            if (AF_STATS_ENABLED && collectStats) seenStyles.insert(elementStyle);
+          } else {
+            AF_COUNT(csiSequences);
+            parseCodePage437Seq(line, i, seqEnd);
+          }
+          i=seqEnd+1;
+      }
+      else {
+          ++i;
+      }
+    } else  if (cur==0x1a && line.length() - i > 6){
+      // skip SAUCE info section
+      while (i<line.length() && (line[i]==0x1a || !line[i])) ++i;
+      if (line.substr(i, 5)=="SAUCE"){
+        skipLineRest=true;
+        return;
+      }
+    } else {
+      if (curX>=0 && curX<asciiArtWidth && curY>=0 && curY<asciiArtHeight){
+        termBuffer[curX + curY*asciiArtWidth].c = line[i];
+        termBuffer[curX + curY*asciiArtWidth].style = internTermStyle(elementStyle);
+        curX++;
+      }
+
+      if (curX==asciiArtWidth || line[i]=='\r' ) {
+        curY++;
+        if (maxY<curY && curY<asciiArtHeight) maxY=curY;
+        curX=0;
+        if (line[i]=='\r') {
+          skipLineRest=true;
+          return;
         }
+      }
+      ++i;
+    }
+  }
+}
 
-          if ( cur==0x1b || (!ignCSISeq && ( cur==0x9b || cur==0xc2)) ) {
+void CodeGenerator::parseLineSegment(std::string_view line)
+{
+  size_t i=0;
+  int cur=0;
+  int next=0;
 
-            if (line.length() - i > 2){
-              next = line[i+1]&0xff;
+  bool isGrepOutput=false;
+  bool isKSeq=false;
 
-              //move index behind CSI
-              if ( (cur==0x1b && next==0x5b) || ( cur==0xc2 && next==0x9b) ) {
-                  ++i;
-              } else {
-                  // restore a unicode sequence if the two digit CSI is not matched
-                  // ansiweather -l Berlin,DE | ansifilter -T
-                  if (cur==0xc2 || cur==0x1b) {
-                      lineBuf << maskCharacter(cur);
-                      ++plainTxtCnt;
-                }
+  while (i <line.length() ) {
 
-              }
+    // copy plain text up to the next control byte in one go
+    size_t runEnd = i + ByteScanner::findSpecialByte(line.data()+i, line.length()-i, !ignCSISeq);
 
-              // http://linuxcommand.org/lc3_adv_tput.php
-              // http://ascii-table.com/ansi-escape-sequences-vt-100.php
-              if (next==0x28){ // ( -> maybe need to handle more codes here
-                  if (line[i+2]==0x42) { // B
-                      elementStyle.setReset(false);
-                      i+=2;
-                }
-              }
+    // a character followed by backspace is deleted
+    if (runEnd<line.length() && runEnd>i && line[runEnd]==0x08) --runEnd;
+
+    while (i<runEnd) {
+      if (lineWrapLen && plainTxtCnt && plainTxtCnt % lineWrapLen==0) {
+        ++lineNumber;
+        printNewLine();
+        insertLineNumber();
+        plainTxtCnt=0;
+      }
+      size_t runLen = runEnd-i;
+      if (lineWrapLen) runLen = std::min(runLen, lineWrapLen - plainTxtCnt % lineWrapLen);
+      if (!scanOnly) appendEscaped(line.data()+i, line.data()+i+runLen, lineBuf);
+      plainTxtCnt+=runLen;
+      i+=runLen;
+    }
 
-            // https://iterm2.com/documentation-escape-codes.html
-            if (next==0x5d) {
+    if (i>=line.length()) break;
 
-                if (line[i+2]=='8') {
+    // CSI ?
+    cur = line[i]&0xff;
 
-                    size_t uriBegin = line.find(';', i+4);
-                    seqEnd = line.find("\x1b]8;;\x07", i);
-                    size_t uriDelim = line.find(0x07, uriBegin+1);
+    if ( (cur&0xff)==0x0d && i<line.length()-1) {
 
-                    if (uriBegin != string::npos && seqEnd != string::npos){
-                        string uri = line.substr(uriBegin+1, uriDelim - uriBegin - 1 );
-                        string txt = line.substr(uriDelim+1, seqEnd - uriDelim - 1);
-                        lineBuf << getHyperlink(uri, txt);
-                        i=seqEnd+4;
-                    }
-                }
-                ++i;
+      AF_COUNT(lineRewinds);
+      plainTxtCnt-=lineOffset+i;
+
+      lineBuf.rewind();
+      //lineBuf<<getOpenTag();
+
+    }
+      // wrap line
+    if (lineWrapLen && plainTxtCnt && plainTxtCnt % lineWrapLen==0) {
+        ++lineNumber;
+        printNewLine();
+        insertLineNumber();
+        plainTxtCnt=0;
+     }
+
+    if ( line.length() - i > 2 && (line[i+1]&0xff)==0x08) i++;
+    if ( cur==0x07) {
+        ++lineNumber;
+        printNewLine();
+        insertLineNumber();
+  }
+
+    if ( cur==0x1b || (!ignCSISeq && ( cur==0x9b || cur==0xc2)) ) {
+
+      if (line.length() - i > 2){
+        next = line[i+1]&0xff;
+        const bool escSeq = cur==0x1b;
+        bool oscSeq = false;
+
+        //move index behind CSI
+        if ( (cur==0x1b && next==0x5b) || ( cur==0xc2 && next==0x9b) ) {
+            ++i;
+        } else {
+            // restore a unicode sequence if the two digit CSI is not matched
+            // ansiweather -l Berlin,DE | ansifilter -T
+            if (cur==0xc2 || cur==0x1b) {
+                lineBuf << maskCharacter(cur);
+                ++plainTxtCnt;
+          }
+
+        }
+
+        // http://linuxcommand.org/lc3_adv_tput.php
+        // http://ascii-table.com/ansi-escape-sequences-vt-100.php
+        if (next==0x28){ // ( -> maybe need to handle more codes here
+            if (charAt(line, i+2)==0x42) { // B
+                elementStyle.setReset(false);
+                i+=2;
+          }
+        }
+
+      // https://iterm2.com/documentation-escape-codes.html
+      if (next==0x5d) {
+
+          AF_COUNT(oscSequences);
+          oscSeq = true;
+          if (charAt(line, i+2)=='8') {
+
+              size_t uriBegin = line.find(';', i+4);
+              seqEnd = line.find("\x1b]8;;\x07", i);
+              size_t uriDelim = line.find(0x07, uriBegin+1);
+
+              if (uriBegin != string::npos && seqEnd != string::npos){
+                  AF_COUNT(hyperlinks);
+                  std::string_view uri = line.substr(uriBegin+1, uriDelim - uriBegin - 1 );
+                  std::string_view txt = line.substr(uriDelim+1, seqEnd - uriDelim - 1);
+                  lineBuf << getHyperlink(uri, txt);
+                  i=seqEnd+4;
+              }
+          }
+          ++i;
+      }
+
+        if (i<line.size()) ++i;
+
+        if (charAt(line, i-1)==0x5b || (charAt(line, i-1)&0xff)==0x9b){
+          seqEnd=i;
+          //find sequence end
+          while (   seqEnd<line.length()
+            && (line[seqEnd]<0x40 || line[seqEnd]>0x7e )) {
+              ++seqEnd;
             }
 
-              if (i<line.size()) ++i;
-
-              if (line[i-1]==0x5b || (line[i-1]&0xff)==0x9b){
-                seqEnd=i;
-                //find sequence end
-                while (   seqEnd<line.length()
-                  && (line[seqEnd]<0x40 || line[seqEnd]>0x7e )) {
-                    ++seqEnd;
-                  }
-
-                  if (   line[seqEnd]=='m' && !ignoreFormatting ) {
-                    if (!elementStyle.isReset()) {
-                      lineBuf << getCloseTag();
-                      tagOpen=false;
-                    }
-                    parseSGRParameters(line, i, seqEnd);
-                    if (!elementStyle.isReset()) {
-                      lineBuf << getOpenTag();
-                      tagOpen=true;
-                    }
-                  }
-
-                  // fix K sequences (iterm2/grep)
-                  isKSeq =  line[seqEnd]=='K' && !ignClearSeq ;
-                  isGrepOutput = isKSeq && line.length() > (seqEnd + 1) && isascii(line[seqEnd+1]) && line[seqEnd+1] !=13 && line[seqEnd+1] != 27;
-
-                  if (   line[seqEnd]=='s' || line[seqEnd]=='u'
-                    || (isKSeq && !isGrepOutput) ){
-                      i=line.length()+1;
-                      omitNewLine = isKSeq; // \n may follow K
-                      //FIXME std::cerr << "K CASE!\n";
-                  }
-                  else {
-                      i = 1 + ((seqEnd!=line.length())?seqEnd:i);
-                  }
-              } else {
-                cur= line[i-1]&0xff;
-                next = line[i]&0xff;
-
-                //ignore content of two and single byte sequences (no CSI)
-                if (cur==0x1b && (  next==0x50 || next==0x5d || next==0x58
-                  || next==0x5e||next==0x5f ) ) // DECSC seq
-                {
-                  seqEnd=i;
-                  //find string end
-                  while ( seqEnd<line.length()
-                      && (line[seqEnd]&0xff)!=0x9e
-                      && line[seqEnd]!=0x07
-                      && (line[seqEnd]&0xff)!=0x3b ) {
-                        ++seqEnd;
-                    }
-
-                    if (line.length() > (seqEnd + 1) && line[seqEnd+1]=='A')
-                        seqEnd++;
-
-                    i=seqEnd+1;
-                } else if (cur==0x1b && (
-                   next==0x37 || next==0x38
-
-                ) ) // DECSC seq
-                {
-                    if (line.length() > (seqEnd + 1) && line[seqEnd+1]==0x1b)
-                        ++i;
-                }
+            if (seqEnd>=line.length())
+              AF_COUNT(ignoredSequences);
+            else if (line[seqEnd]=='m')
+              AF_COUNT(sgrSequences);
+            else
+              AF_COUNT(csiSequences);
+
+            if (   charAt(line, seqEnd)=='m' && !ignoreFormatting ) {
+              if (!elementStyle.isReset()) {
+                lineBuf << closeTag();
+                tagOpen=false;
               }
-            } else {
-                ++i;
+              parseSGRParameters(line, i, seqEnd);
+              if (!elementStyle.isReset()) {
+                AF_PROBE2(style_change, elementStyle.getFgColour().getRGB(), elementStyle.getBgColour().getRGB());
+                if (AF_STATS_ENABLED && collectStats) seenStyles.insert(elementStyle);
+                lineBuf << openTag();
+                tagOpen=true;
+              }
+            }
+
+            // fix K sequences (iterm2/grep)
+            isKSeq =  charAt(line, seqEnd)=='K' && !ignClearSeq ;
+            isGrepOutput = isKSeq && line.length() > (seqEnd + 1) && isascii(line[seqEnd+1]) && line[seqEnd+1] !=13 && line[seqEnd+1] != 27;
+
+            if (   charAt(line, seqEnd)=='s' || charAt(line, seqEnd)=='u'
+              || (isKSeq && !isGrepOutput) ){
+                if (isKSeq) AF_COUNT(lineDrops);
+                omitNewLine = isKSeq; // \n may follow K
+                skipLineRest=true;
+                return;
+            }
+            else {
+                i = 1 + ((seqEnd!=line.length())?seqEnd:i);
             }
-          } else if (!ignCSISeq && (cur==0x90 || cur==0x9d || cur==0x98 || cur==0x9e ||cur==0x9f)) {
+        } else {
+          cur= charAt(line, i-1)&0xff;
+          next = charAt(line, i)&0xff;
+
+          // charset selection, DECSC, DCS, PM, APC and unknown sequences
+          if (escSeq && !oscSeq) AF_COUNT(ignoredSequences);
+
+          //ignore content of two and single byte sequences (no CSI)
+          if (cur==0x1b && (  next==0x50 || next==0x5d || next==0x58
+            || next==0x5e||next==0x5f ) ) // DECSC seq
+          {
             seqEnd=i;
             //find string end
-            while (   seqEnd<line.length() && (line[seqEnd]&0xff)!=0x9e
-              && line[seqEnd]!=0x07 ) {
-              ++seqEnd;
+            while ( seqEnd<line.length()
+                && (line[seqEnd]&0xff)!=0x9e
+                && line[seqEnd]!=0x07
+                && (line[seqEnd]&0xff)!=0x3b ) {
+                  ++seqEnd;
               }
-              // handle false positives in unicode sequences
-              // TODO fix set terminal title CSI (testansi.py)
-              if (seqEnd<line.length() ) {
-                  i=seqEnd+1;
-              } else {
-                lineBuf << maskCharacter(line[i]);
-                ++i;
-                ++plainTxtCnt;
-              }
-          } else {
-            // output printable character
-            lineBuf << maskCharacter(line[i]);
-            ++i;
-            ++plainTxtCnt;
+
+              if (line.length() > (seqEnd + 1) && line[seqEnd+1]=='A')
+                  seqEnd++;
+
+              i=seqEnd+1;
+          } else if (cur==0x1b && (
+             next==0x37 || next==0x38
+
+          ) ) // DECSC seq
+          {
+              if (line.length() > (seqEnd + 1) && line[seqEnd+1]==0x1b)
+                  ++i;
           }
         }
+      } else {
+          ++i;
       }
+    } else if (!ignCSISeq && (cur==0x90 || cur==0x9d || cur==0x98 || cur==0x9e ||cur==0x9f)) {
+      seqEnd=i;
+      //find string end
+      while (   seqEnd<line.length() && (line[seqEnd]&0xff)!=0x9e
+        && line[seqEnd]!=0x07 ) {
+        ++seqEnd;
+        }
+        // handle false positives in unicode sequences
+        // TODO fix set terminal title CSI (testansi.py)
+        if (seqEnd<line.length() ) {
+            AF_COUNT(ignoredSequences);
+            i=seqEnd+1;
+        } else {
+          lineBuf << maskCharacter(line[i]);
+          ++i;
+          ++plainTxtCnt;
+        }
+    } else {
+      // output printable character
+      lineBuf << maskCharacter(line[i]);
+      ++i;
+      ++plainTxtCnt;
     }
-  } // while (true)
-
-  if (tagOpen) {
-    *out <<getCloseTag();
   }
-
-  if (parseCP437){
-    printTermBuffer();
-  }
-  out->flush();
 }
 
 
-void CodeGenerator::printNewLine(bool eof) {
+void CodeGenerator::printNewLine(bool eof, bool lineBreak) {
 
-    string lineStr(lineBuf.str());
-    if (eof) {
-        lineStr = lineStr.substr(0, lineBuf.tellp());
-    }
-    *out << lineStr;
+    std::string_view lineStr = eof ? lineBuf.writtenView() : lineBuf.view();
+    out->write(lineStr.data(), lineStr.size());
     *out << lineAppendage;
-    *out << newLineTag;
+    if (lineBreak)
+        *out << newLineTag;
 
     lineBuf.clear();
-    lineBuf.str(std::string());
 }
 
 
@@ -1403,41 +2231,111 @@ void CodeGenerator::xterm2rgb(unsigned char color, unsigned char* rgb)
     }
 }
 
-string CodeGenerator::rgb2html(unsigned char* rgb){
+const string& CodeGenerator::openTag()
+{
+    auto it = openTagCache.find(elementStyle);
+    if (it != openTagCache.end()) {
+        ++tagCacheHits;
+        tagIsOpen = it->second.tagIsOpen;
+        return it->second.tag;
+    }
+
+    ++tagCacheMisses;
+    if (openTagCache.size()>=maxTagCacheSize) openTagCache.clear();
 
-  std::array<char, 8> colorString;  // 7 characters for "#RRGGBB" and 1 for '\0'
-  std::snprintf(colorString.data(), colorString.size(), "#%02x%02x%02x", rgb[0], rgb[1], rgb[2]);
-  return std::string(colorString.data());
+    string tag = getOpenTag();
+    return openTagCache.emplace(elementStyle, CachedTag{tag, tagIsOpen}).first->second.tag;
 }
 
-string CodeGenerator::rgb2html(int r, int g, int b){
-  std::array<char, 8> colorString;  // 7 characters for "#RRGGBB" and 1 for '\0'
-  std::snprintf(colorString.data(), colorString.size(), "#%02x%02x%02x", r, g, b);
-  return std::string(colorString.data());
+const string& CodeGenerator::closeTag()
+{
+    auto& cache = closeTagCache[tagIsOpen ? 1 : 0];
+    auto it = cache.find(elementStyle);
+    if (it != cache.end()) {
+        ++tagCacheHits;
+        tagIsOpen = it->second.tagIsOpen;
+        return it->second.tag;
+    }
+
+    ++tagCacheMisses;
+    if (cache.size()>=maxTagCacheSize) cache.clear();
+
+    string tag = getCloseTag();
+    return cache.emplace(elementStyle, CachedTag{tag, tagIsOpen}).first->second.tag;
 }
 
-const unsigned char CodeGenerator::valuerange[] = { 0x00, 0x5F, 0x87, 0xAF, 0xD7, 0xFF };
+void DerivedStyleRegistry::setNumberedByKey(bool flag)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    numberedByKey = flag;
+}
 
-unsigned char CodeGenerator::defaultPalette[16][3] = {
-    { 0x00, 0x00, 0x00 }, // 0 ColorBlack
-    { 0xCD, 0x00, 0x00 }, // 1 ColorRed
-    { 0x00, 0xCD, 0x00 }, // 2 ColorGreen
-    { 0xCD, 0xCD, 0x00 }, // 3 ColorYellow
-    { 0x00, 0x00, 0xEE }, // 4 ColorBlue
-    { 0xCD, 0x00, 0xCD }, // 5 ColorMagenta
-    { 0x00, 0xCD, 0xCD }, // 6 ColorCyan
-    { 0xE5, 0xE5, 0xE5 }, // 7 ColorGray
-    { 0x7F, 0x7F, 0x7F }, // 8 ColorDarkGray
-    { 0xFF, 0x00, 0x00 }, // 9 ColorBrightRed
-    { 0x00, 0xFF, 0x00 }, // 10 ColorBrightGreen
-    { 0xFF, 0xFF, 0x00 }, // 11 ColorBrightYellow
-    { 0x5C, 0x5C, 0xFF }, // 12 ColorBrightBlue
-    { 0xFF, 0x00, 0xFF }, // 13 ColorBrightMagenta
-    { 0x00, 0xFF, 0xFF }, // 14 ColorBrightCyan
-    { 0xFF, 0xFF, 0xFF }  // 15 ColorBrightWhite
-};
+uint64_t DerivedStyleRegistry::getClassNumber(const StyleInfo& style)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t key = style.getKey();
+    auto entry = classNumbers.emplace(key, numberedByKey ? key : styles.size()+1);
+    if (entry.second) {
+        styles.push_back(style);
+    }
+    return entry.first->second;
+}
+
+vector<StyleInfo> DerivedStyleRegistry::getStyles() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    vector<StyleInfo> ordered(styles);
+    if (numberedByKey) {
+        std::sort(ordered.begin(), ordered.end(),
+                  [](const StyleInfo& a, const StyleInfo& b) { return a.getKey() < b.getKey(); });
+    }
+    return ordered;
+}
+
+uint64_t CodeGenerator::registerDocumentStyle(const StyleInfo& style)
+{
+    return styleRegistry->getClassNumber(style);
+}
+
+void CodeGenerator::setDerivedStyleRegistry(DerivedStyleRegistry* registry)
+{
+    styleRegistry = registry ? registry : &ownStyleRegistry;
+    clearTagCache();
+}
+
+void CodeGenerator::clearTagCache()
+{
+    openTagCache.clear();
+    closeTagCache[0].clear();
+    closeTagCache[1].clear();
+}
+
+string CodeGenerator::maskCharacter(unsigned char c)
+{
+    std::string_view replacement = (*escapeTable)[c];
+    if (replacement.data()) {
+        return string(replacement);
+    }
+    return string(1, c);
+}
+
+void CodeGenerator::appendEscaped(const char* begin, const char* end, LineBuffer& buffer)
+{
+    const char* runStart = begin;
+    for (const char* c = begin; c<end; c++) {
+        std::string_view replacement = (*escapeTable)[(unsigned char)*c];
+        if (replacement.data()) {
+            if (c>runStart) buffer.append(runStart, c-runStart);
+            buffer.append(replacement.data(), replacement.size());
+            runStart = c+1;
+        }
+    }
+    if (end>runStart) buffer.append(runStart, end-runStart);
+}
 
-unsigned char CodeGenerator::workingPalette[16][3] = {
+const unsigned char CodeGenerator::valuerange[] = { 0x00, 0x5F, 0x87, 0xAF, 0xD7, 0xFF };
+
+const unsigned char CodeGenerator::defaultPalette[16][3] = {
     { 0x00, 0x00, 0x00 }, // 0 ColorBlack
     { 0xCD, 0x00, 0x00 }, // 1 ColorRed
     { 0x00, 0xCD, 0x00 }, // 2 ColorGreen
@@ -1458,8 +2356,11 @@ unsigned char CodeGenerator::workingPalette[16][3] = {
 
 bool CodeGenerator::setColorMap(const string& mapPath){
 
+  clearTagCache();
+
   //restore default colors
   if (mapPath.length()==0){
+   memcpy(colorMapPalette, defaultPalette, sizeof defaultPalette);
    memcpy(workingPalette, defaultPalette, sizeof defaultPalette);
    return true;
   }
@@ -1484,9 +2385,10 @@ bool CodeGenerator::setColorMap(const string& mapPath){
 
         s>>colorCode;
         if (colorCode.size()>=7 && colorCode[0]=='#' ) {
-          workingPalette[idx][0] = (char)std::strtol(colorCode.substr ( 1, 2 ).c_str(), nullptr, 16);
-          workingPalette[idx][1] = (char)std::strtol(colorCode.substr ( 3, 2 ).c_str(), nullptr, 16);
-          workingPalette[idx][2] = (char)std::strtol(colorCode.substr ( 5, 2 ).c_str(), nullptr, 16);
+          colorMapPalette[idx][0] = (char)std::strtol(colorCode.substr ( 1, 2 ).c_str(), nullptr, 16);
+          colorMapPalette[idx][1] = (char)std::strtol(colorCode.substr ( 3, 2 ).c_str(), nullptr, 16);
+          colorMapPalette[idx][2] = (char)std::strtol(colorCode.substr ( 5, 2 ).c_str(), nullptr, 16);
+          memcpy(workingPalette[idx], colorMapPalette[idx], 3);
         } else {
           return false;
         }
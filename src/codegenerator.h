@@ -30,13 +30,25 @@ along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
 #include <string>
 #include <string_view>
 #include <vector>
+#include <array>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
 #include <iomanip>
+#include <memory>
+#include <optional>
 
 // Avoid problems with isspace and UTF-8 characters, use iswspace instead
 //#include <cctype>
 #include <wctype.h>
 
 #include "elementstyle.h"
+#include "linereader.h"
+#include "linebuffer.h"
+#include "outputsink.h"
+#include "mappedfile.h"
+#include "filefollower.h"
+#include "conversionstats.h"
 
 #include "enums.h"
 #include "stringtools.h"
@@ -68,74 +80,106 @@ namespace ansifilter
   /** TheDraw output information of individual characters*/
   struct TDChar {
     unsigned char c;
-    ElementStyle style;
+    uint16_t style;    ///< index into CodeGenerator::termStyles
   };
 
+  /** Replacement strings of an output format, indexed by input byte. Entries
+      without data (default constructed) are copied unchanged, empty strings
+      remove the byte from the output. */
+  typedef std::array<std::string_view, 256> EscapeTable;
+
+  /** \return escape table which removes control characters except tab */
+  constexpr EscapeTable makeEscapeTable()
+  {
+      EscapeTable table{};
+      for (int c=0; c<0x20; c++) table[c] = "";
+      table['\t'] = std::string_view();
+      return table;
+  }
+
 
   class StyleInfo
 {
 public:
 
     /// Constructor
-    StyleInfo() :  fgColor ( "" ), bgColor ( "" ), isBold (false), isItalic (false), isConcealed (false), isBlink (false), isUnderLine (false)
+    StyleInfo() :  isFgColorSet (false), isBgColorSet (false),
+        isBold (false), isItalic (false), isConcealed (false), isBlink (false), isUnderLine (false)
     {
     }
 
     /// Constructor
-    StyleInfo (  const string& fgc, const string& bgc, bool b, bool i, bool c, bool blink, bool ul ) :
-        fgColor ( fgc ), bgColor ( bgc ),isBold ( b ), isItalic ( i ), isConcealed ( c ), isBlink (blink), isUnderLine (ul)
+    explicit StyleInfo ( const ElementStyle& style ) :
+        fgColour ( style.isFgColorSet() ? style.getFgColour() : StyleColour() ),
+        bgColour ( style.isBgColorSet() ? style.getBgColour() : StyleColour() ),
+        isFgColorSet ( style.isFgColorSet() ), isBgColorSet ( style.isBgColorSet() ),
+        isBold ( style.isBold() ), isItalic ( style.isItalic() ), isConcealed ( style.isConceal() ),
+        isBlink ( style.isBlink() ), isUnderLine ( style.isUnderline() )
     {
     }
 
-    /// Copy Constructor
-    StyleInfo ( const StyleInfo& other )
+    bool operator==(const StyleInfo& r) const
     {
-        fgColor = other.fgColor;
-        bgColor = other.bgColor;
-
-        isItalic = other.isItalic;
-        isBold = other.isBold;
-        isConcealed=other.isConcealed;
-        isBlink = other.isBlink;
-        isUnderLine = other.isUnderLine;
+        return this->fgColour==r.fgColour && this->bgColour==r.bgColour
+                && this->isFgColorSet==r.isFgColorSet && this->isBgColorSet==r.isBgColorSet
+                && this->isBold==r.isBold && this->isItalic==r.isItalic && this->isConcealed==r.isConcealed
+                && this->isBlink==r.isBlink && this->isUnderLine==r.isUnderLine;
     }
 
-    /// Operator overloading
-    StyleInfo& operator= ( const StyleInfo & other )
+    /** \return all properties packed into one integer, equal keys mean equal styles */
+    uint64_t getKey() const
     {
-        fgColor = other.fgColor;
-        bgColor = other.bgColor;
+        return (uint64_t)fgColour.getRGB() | (uint64_t)bgColour.getRGB()<<24
+               | (uint64_t)isFgColorSet<<48 | (uint64_t)isBgColorSet<<49
+               | (uint64_t)isBold<<50 | (uint64_t)isItalic<<51 | (uint64_t)isConcealed<<52
+               | (uint64_t)isBlink<<53 | (uint64_t)isUnderLine<<54;
+    }
 
-        isItalic = other.isItalic;
-        isBold = other.isBold;
-        isConcealed=other.isConcealed;
-        isBlink = other.isBlink;
-        isUnderLine = other.isUnderLine;
+    StyleColour fgColour;    ///< foreground color
+    StyleColour bgColour;    ///< background color
+    bool isFgColorSet, isBgColorSet;  ///< colours are only valid if set
+    bool isBold, isItalic, isConcealed, isBlink, isUnderLine;  ///< style properties
+};
 
-        return *this;
-    }
+/** \brief Numbers the styles derived from document formatting (--derived-styles).
 
-    bool operator==(const StyleInfo& r)
-    {
-        return this->fgColor==r.fgColor && this->bgColor==r.bgColor && this->isBold==r.isBold
-                && this->isItalic==r.isItalic && this->isConcealed==r.isConcealed
-                && this->isBlink==r.isBlink && this->isUnderLine==r.isUnderLine;
-    }
+    A registry may be shared by several generators which convert files in
+    parallel; all methods are thread safe. The order in which parallel
+    conversions register their styles depends on the thread scheduling, so
+    such a registry should number the styles by key (see setNumberedByKey()).
+*/
+class DerivedStyleRegistry
+{
+public:
 
-    ~StyleInfo()
-    {
-    }
+    /** Use StyleInfo::getKey() as class number instead of numbering the
+        styles in order of appearance. Call before the first style is registered.
+        \param flag true if the class numbers are the style keys */
+    void setNumberedByKey(bool flag);
 
-    string fgColor;    ///< foreground color
-    string bgColor;    ///< background color
-    bool isBold, isItalic, isConcealed, isBlink, isUnderLine;  ///< style properties
-   };
+    /** Register a style if it was not seen before
+        \param style derived style
+        \return 1-based class number or key of the style */
+    uint64_t getClassNumber(const StyleInfo& style);
+
+    /** \return registered styles ordered by class number */
+    vector<StyleInfo> getStyles() const;
+
+private:
+    mutable std::mutex mutex;
+    bool numberedByKey = false;
+    vector<StyleInfo> styles;                         ///< derived styles in order of appearance
+    std::unordered_map<uint64_t, uint64_t> classNumbers; ///< maps StyleInfo keys to class numbers
+};
 
 /** \brief Base class for escape sequence parsing.
 
     The virtual class provides escape sequence parsing functionality.<br>
     The derived classes have to define the output format.<br>
-    Codegenerator is a singleton class.
+    Instances do not share mutable state, so separate instances may convert
+    concurrently in different threads. A single instance must not be used
+    by several threads at the same time; only a DerivedStyleRegistry may be
+    shared (see setDerivedStyleRegistry()).
 
 * @author Andre Simon
 */
@@ -178,6 +222,20 @@ public:
     */
     string generateString(const string &input);
 
+    /**
+     Generates output from an input string without copying the input
+     \param input input code
+     \param output receives the formatted output; its capacity is reused
+    */
+    void generate(std::string_view input, string& output);
+
+    /**
+     Generates output from an input string and appends it to a buffer
+     \param input input code
+     \param output the formatted output is appended to this buffer
+    */
+    void generateAppend(std::string_view input, string& output);
+
     /**
      Generates output string from input file
      \param inFileName file path
@@ -196,6 +254,42 @@ public:
                                        const string &outFileName,
                                        const string &title);
 
+    /**
+     Begins an incremental conversion of input which is passed with feed().
+     A conversion which was begun but not finished is abandoned: its
+     unconverted input and buffered output are discarded, the output of
+     earlier feed() calls was already written. Destroying the generator
+     abandons a conversion as well.
+     \param outFileName Path of output file (if empty use stdout)
+     \return ParseError
+    */
+    ParseError begin(const string &outFileName);
+
+    /**
+     Begins an incremental conversion of input which is passed with feed(),
+     see begin(const string&) for an unfinished previous conversion
+     \param callback function which receives the output blocks; it is not
+                     called after the conversion was abandoned
+    */
+    void begin(CallbackOutputSink::Callback callback);
+
+    /**
+     Converts the next part of the input. The output of complete lines is
+     written before the call returns; the rest of the input is kept until the
+     next call. Formatting and line numbers continue across calls.
+     BIN, XBIN and Tundra ANSI art is not supported.
+     \param data input bytes
+     \param size number of bytes
+     \return false if the output could not be written
+    */
+    bool feed(const char* data, size_t size);
+
+    /**
+     Converts the remaining input and ends the document
+     \return ParseError
+    */
+    ParseError finish();
+
     /** Generate a stylesheet with the styles found in the document
     \param outPath Output path
     \return true if successful
@@ -271,6 +365,21 @@ public:
         readAfterEOF=b;
     }
 
+    /** \param lines number of lines of the input file which are printed before following it,
+                     0 to start at the end of the file, empty to print the last few lines
+                     (applies if reading continues after EOF) */
+    void setTailLines(std::optional<size_t> lines)
+    {
+        tailLines=lines;
+    }
+
+    /** \param b set to true if regular input files should be memory mapped
+                 instead of read as stream (ignored if reading continues after EOF) */
+    void setMemoryMapping(bool b)
+    {
+        useMemoryMapping=b;
+    }
+
      /** \param b set to true if the output should not be terminated with EOL*/
     void setOmitTrailingCR(bool b)
     {
@@ -336,6 +445,56 @@ public:
 
     void setLineAppendage(const string& a);
 
+    /** Share the numbering of derived styles with other generators, so a
+        single stylesheet can be written for all output files
+        \param registry shared registry, nullptr to use the own one */
+    void setDerivedStyleRegistry(DerivedStyleRegistry* registry);
+
+    /** \param size size of the output buffer of generateFile() */
+    void setOutputBufferSize(size_t size);
+
+    /// default minimum size of the chunks of setChunkWorkers()
+    static const size_t defaultChunkSize = 8*1024*1024;
+
+    /** Convert large memory mapped input files in parallel. The input is
+        split into chunks at line starts, the chunks are rendered by the
+        workers and written in input order. A pre-scan which only parses the
+        escape sequences determines formatting and line number at each chunk
+        start, so the output is identical to the sequential conversion.
+        \param workers generators configured like this one, they must not be
+                       used otherwise while this generator converts a file
+        \param size minimum chunk size in bytes; inputs smaller than two
+                    chunks are converted sequentially */
+    void setChunkWorkers(const vector<CodeGenerator*>& workers, size_t size=defaultChunkSize);
+
+    /** \return number of formatting tags taken from the tag cache */
+    size_t getTagCacheHits() const
+    {
+        return tagCacheHits;
+    }
+
+    /** \return number of formatting tags which had to be rendered */
+    size_t getTagCacheMisses() const
+    {
+        return tagCacheMisses;
+    }
+
+    /** Measure the read, render and write times and count the distinct
+        styles of the following conversions; the other counters of
+        getStats() are always updated
+        \param flag true if the conversions should be measured */
+    void setCollectStats(bool flag)
+    {
+        collectStats = flag;
+    }
+
+    /** \return statistics of the last conversion of generateFile(),
+        generate() or the push API */
+    const ConversionStats& getStats() const
+    {
+        return stats;
+    }
+
 protected:
 
     /** \param type Output type */
@@ -343,9 +502,27 @@ protected:
 
     CodeGenerator() {}
 
+    /** \return opening formatting sequence of the current style; getOpenTag()
+        is only called if the style is not cached yet */
+    const string& openTag();
+
+    /** \return closing formatting sequence of the current style; getCloseTag()
+        is only called if the style is not cached yet */
+    const string& closeTag();
+
+    /** Drop all cached tags, call this if an option changes the tag output */
+    void clearTagCache();
+
     /** \param c Character to be masked
-        \return Escape sequence of output format */
-    virtual string maskCharacter(unsigned char c) = 0;
+        \return Escape sequence of output format, looked up in escapeTable */
+    virtual string maskCharacter(unsigned char c);
+
+    /** Append text and replace special characters as defined by escapeTable.
+        Unescaped runs are copied in one go.
+        \param begin start of text
+        \param end end of text
+        \param buffer output buffer */
+    virtual void appendEscaped(const char* begin, const char* end, LineBuffer& buffer);
 
     /** \param c Character to be masked
      \return Codepage 437 escape sequence of output format */
@@ -370,10 +547,13 @@ protected:
     istream *in;
 
     /** file output*/
-    ostream *out;
+    OutputSink *out;
+
+    /** owner of out during an incremental conversion (begin, feed, finish) */
+    std::unique_ptr<OutputSink> pushOutput;
 
     /** line buffer*/
-    ostringstream lineBuf;
+    LineBuffer lineBuf;
 
     bool tagIsOpen; ///< a reminder to close an open tag
 
@@ -388,6 +568,9 @@ protected:
 
     string spacer;
 
+    /** Escape table of the output format */
+    const EscapeTable* escapeTable;
+
     /** Test if header and footer should be omitted */
     bool fragmentOutput;
 
@@ -420,32 +603,40 @@ protected:
     /** Processes input data */
     void processInput();
 
+    /** Reset the formatting state before a new input is processed */
+    void resetInputState();
+
     virtual void insertLineNumber ();
 
+    /** \return current line number, right aligned in a field of lineNumberWidth characters */
+    string formatLineNumber() const;
+
     /** \return true id encoding is defined */
     bool encodingDefined()
     {
         return StringTools::lowerCase(encoding)!="none";
     }
 
-    /** convert a rgb triple to HTML color notation
-    @param rgb RGB input values
-    @return HTML color string
-    */
-    string rgb2html(unsigned char* rgb);
-
-    string rgb2html(int r, int g, int b);
-
     /// 16 basic colors
-    static unsigned char workingPalette[16][3];
-    static unsigned char defaultPalette[16][3];
+    static const unsigned char defaultPalette[16][3];
+    unsigned char colorMapPalette[16][3];   ///< defaultPalette with the colours of setColorMap()
+    unsigned char workingPalette[16][3];    ///< palette of the current input, may be replaced by XBIN files
 
     ElementStyle elementStyle;
+    ElementStyle initialStyle;   ///< style at the beginning of each input
 
-    vector<StyleInfo> documentStyles;
+    DerivedStyleRegistry ownStyleRegistry;
+    DerivedStyleRegistry* styleRegistry;   ///< ownStyleRegistry or a registry shared with other generators
+
+    /** Add a style to the derived styles if it was not seen before
+        \param style derived style
+        \return class number of the style, see DerivedStyleRegistry::getClassNumber() */
+    uint64_t registerDocumentStyle(const StyleInfo& style);
 
 private:
 
+    friend class MicroBenchmark; ///< benchmarks the private hot functions (bench/microbench.cpp)
+
     CodeGenerator(const CodeGenerator&) {}
 
     CodeGenerator& operator=(CodeGenerator&)
@@ -458,14 +649,22 @@ private:
         @param begin starting position within line
         @param end ending position within line
         @return true if sequence was recognized */
-    bool parseSGRParameters(const string& line, size_t begin, size_t end);
+    bool parseSGRParameters(std::string_view line, size_t begin, size_t end);
 
     /** parses Codepage 437 sequence information
         @param line text line
         @param begin starting position within line
         @param end ending position within line
         */
-    void parseCodePage437Seq(string line, size_t begin, size_t end);
+    void parseCodePage437Seq(std::string_view line, size_t begin, size_t end);
+
+    /** parses a line or a segment of a long line
+        @param line text line (segment) */
+    void parseLineSegment(std::string_view line);
+
+    /** parses a line segment of a codepage 437 file
+        @param line text line (segment) */
+    void parseCodePage437Segment(std::string_view line);
 
     /** Prints document footer
         @return footer */
@@ -474,6 +673,12 @@ private:
     /** Prints document body*/
     virtual void printBody() = 0;
 
+    /** Prints the part of the document body which precedes the converted input */
+    virtual void printBodyBegin() {}
+
+    /** Prints the part of the document body which follows the converted input */
+    virtual void printBodyEnd() {}
+
     /** Prints document header
         @return header
     */
@@ -488,25 +693,129 @@ private:
     virtual string getOpenTag() = 0;  ///< returns opening formatting sequence
     virtual string getCloseTag() = 0; ///< returns closing formatting sequence
 
+    /** rendered tag and the tagIsOpen state after rendering it */
+    struct CachedTag {
+        string tag;
+        bool tagIsOpen;
+    };
+
+    /// maximum number of cached tags, the cache is cleared if it grows beyond
+    static const size_t maxTagCacheSize = 4096;
+
+    std::unordered_map<ElementStyle, CachedTag> openTagCache;
+    std::unordered_map<ElementStyle, CachedTag> closeTagCache[2]; ///< indexed by tagIsOpen before rendering
+    size_t tagCacheHits, tagCacheMisses;
+
     bool ignoreFormatting; ///< ignore color and font face information
     bool readAfterEOF;     ///< continue reading after EOF occurred
+    std::optional<size_t> tailLines; ///< number of lines printed before following the input, empty if not set
+    bool useMemoryMapping; ///< map regular input files into memory
     bool omitTrailingCR;   ///< do not print EOL at the end of output
     bool ignClearSeq;      ///< ignore clear sequence ESC K
     bool ignCSISeq;       ///< ignore CSIs (may interfere with UTF-8 input)
 
     TDChar* termBuffer;
+    std::vector<ElementStyle> termStyles;                   ///< distinct styles of termBuffer, 0 is the default style
+    std::unordered_map<ElementStyle, uint16_t> termStyleIndex; ///< position of each style in termStyles
+    uint16_t lastTermStyle;                                 ///< index of the most recently stored style
     unsigned int curX, curY, memX, memY, maxY; ///< cursor position for Codepage 437 sequences
     unsigned int asciiArtWidth;        ///< virtual console column count
     unsigned int asciiArtHeight;       ///< virtual console line count
+    unsigned int artWidthOption, artHeightOption; ///< console size of setAsciiArtSize(), XBIN and Tundra files set their own
     unsigned int lineWrapLen; ///< max line length before wrapping
 
     string lineAppendage; ///< user defined end of line append string
 
+    size_t outputBufferSize; ///< size of the output buffer of generateFile()
+
+    LineReader lineReader;   ///< block based input reader
+    MappedFile mappedInput;  ///< memory mapped input file, used instead of in if available
+    FileFollower followedInput; ///< input file followed after EOF, used instead of in if available
+    std::string_view memoryInput; ///< input string of generate(), used instead of in if available
+
+    size_t plainTxtCnt;      ///< count of printable characters in current line
+    size_t lineOffset;       ///< position of current segment within the input line
+    size_t seqEnd;           ///< end of last escape sequence
+    bool tagOpen;            ///< a closing tag has to be printed at the end of input
+    bool lineStart;          ///< the next segment begins an input line
+    bool omitNewLine;        ///< current line continues the previous output line
+    bool skipLineRest;       ///< ignore remaining segments of current line
+    bool scanOnly;           ///< pre-scan of a chunked conversion, text is not rendered
+
+    ConversionStats stats;   ///< counters and timings of the current conversion
+    bool collectStats;       ///< measure timings and distinct styles, see setCollectStats()
+    std::unordered_set<ElementStyle> seenStyles; ///< distinct styles of the current conversion
+    uint64_t statsReadBase;  ///< bytes read by lineReader before the conversion
+    double statsWallStart, statsCpuStart;
+
+    /** Parser state at the beginning of an input chunk */
+    struct ChunkState {
+        size_t offset;           ///< input offset of the first line
+        ElementStyle style;      ///< formatting in effect
+        unsigned int lineNumber; ///< number of the preceding line
+        bool tagOpen, tagIsOpen;
+    };
+
+    /** chunk states found by the pre-scan, shared with the workers */
+    struct ChunkQueue;
+
+    vector<CodeGenerator*> chunkWorkers; ///< generators which render chunks of the input
+    size_t chunkSize;                    ///< minimum size of a chunk
+
     ElementStyle memStyle;
 
-    /** clear line buffer
+    /** Open the output destination of generateFile()
+        \param outFileName output file path, stdout if empty
+        \return output sink or nullptr if the file could not be opened */
+    OutputSink* openOutput(const string& outFileName);
+
+    /** print and clear line buffer
+        \param eof true if the input ended
+        \param lineBreak false to omit the line break (--no-trailing-nl at EOF)
     */
-    void printNewLine(bool eof=false);
+    void printNewLine(bool eof=false, bool lineBreak=true);
+
+    /** Print the beginning of the document and prepare the line reader for feed() */
+    void beginPush();
+
+    /** Discard the output sink of an unfinished incremental conversion */
+    void abandonPush();
+
+    /** Reset the statistics and start the timers; out must be set */
+    void beginStats();
+
+    /** Complete the statistics after the output was flushed */
+    void endStats();
+
+    /** Prepare processLines() for the beginning of an input */
+    void resetLineState();
+
+    /** Parses the lines of the line reader until EOF
+        @param lastChunk false if the input is continued by another chunk
+                         or feed() call, the output is then not terminated
+        @param chunks if not nullptr, the parser states at the chunk
+                      boundaries are passed to this queue (pre-scan) */
+    void processLines(bool lastChunk, ChunkQueue* chunks);
+
+    /** Restore the formatting state at the beginning of the followed input
+        \param start offset where the output begins */
+    void recoverTailStyle(off_t start);
+
+    /** Write the output of the current line if it is complete */
+    void flushCompleteLine();
+
+    /** Flush the output and wait until more input is available after EOF */
+    void waitForInput();
+
+    /** Renders the mapped input in chunks with the chunk workers */
+    void processChunks();
+
+    /** Renders a chunk of the input
+        @param chunk input lines
+        @param state parser state at the chunk start
+        @param lastChunk true if this is the end of the input
+        @param result receives the output */
+    void renderChunk(std::string_view chunk, const ChunkState& state, bool lastChunk, string& result);
 
     /** convert an xterm color value (0-253) to 3 unsigned chars rgb
         @param color xterm color
@@ -528,6 +837,12 @@ private:
     /**allocate virtual terminal buffer */
     void allocateTermBuffer();
 
+    /** Adds a style to the style table of the virtual terminal buffer.
+        If the table is full, the default style is used instead.
+        \param style style of a termBuffer cell
+        \return index of style in termStyles */
+    uint16_t internTermStyle(const ElementStyle& style);
+
     /** @return true if stream begins with XBIN id  */
     bool streamIsXBIN();
 
@@ -0,0 +1,132 @@
+/***************************************************************************
+                          conversionstats.cpp  -  description
+                             -------------------
+    copyright            : (C) 2024 by Andre Simon
+    email                : a.simon@mailbox.org
+ ***************************************************************************/
+
+/*
+This file is part of ANSIFilter.
+
+ANSIFilter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ANSIFilter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "conversionstats.h"
+
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+
+namespace ansifilter
+{
+
+double ConversionStats::wallClock()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double ConversionStats::cpuClock(bool thread)
+{
+#if defined(CLOCK_THREAD_CPUTIME_ID) && defined(CLOCK_PROCESS_CPUTIME_ID)
+    struct timespec ts;
+    if (clock_gettime(thread ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID, &ts) == 0) {
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+    }
+    return 0.0;
+#else
+    (void)thread;
+    return double(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+/** \return phase as "wall / cpu" pair in milliseconds */
+static std::string formatPhase(const PhaseTime& t)
+{
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(3) << t.wall*1000.0 << " ms wall, "
+       << t.cpu*1000.0 << " ms cpu";
+    return os.str();
+}
+
+std::string ConversionStats::toText(const std::string& name) const
+{
+    std::ostringstream os;
+    os << "ansifilter stats: " << (name.empty() ? "stdin" : name) << "\n"
+       << "  bytes in:          " << bytesIn << "\n"
+       << "  bytes out:         " << bytesOut << "\n"
+       << "  lines:             " << lines << "\n"
+       << "  SGR sequences:     " << sgrSequences << "\n"
+       << "  other CSI:         " << csiSequences << "\n"
+       << "  OSC sequences:     " << oscSequences << "\n"
+       << "  OSC 8 hyperlinks:  " << hyperlinks << "\n"
+       << "  ignored sequences: " << ignoredSequences << "\n"
+       << "  distinct styles:   " << distinctStyles << "\n"
+       << "  CR line rewinds:   " << lineRewinds << "\n"
+       << "  K line drops:      " << lineDrops << "\n"
+       << "  total time:        " << formatPhase(total) << "\n"
+       << "  read time:         " << formatPhase(read) << "\n"
+       << "  render time:       " << formatPhase(render) << "\n"
+       << "  write time:        " << formatPhase(write) << "\n";
+    return os.str();
+}
+
+/** \return JSON string literal */
+static std::string quoteJSON(const std::string& s)
+{
+    std::ostringstream os;
+    os << '"';
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (c < 0x20) {
+            os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec;
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+    return os.str();
+}
+
+/** \return phase as JSON object, times in seconds */
+static std::string phaseJSON(const PhaseTime& t)
+{
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(6) << "{\"wall\":" << t.wall << ",\"cpu\":" << t.cpu << "}";
+    return os.str();
+}
+
+std::string ConversionStats::toJSON(const std::string& name) const
+{
+    std::ostringstream os;
+    os << "{\"input\":" << quoteJSON(name.empty() ? "stdin" : name)
+       << ",\"bytes_in\":" << bytesIn
+       << ",\"bytes_out\":" << bytesOut
+       << ",\"lines\":" << lines
+       << ",\"sgr_sequences\":" << sgrSequences
+       << ",\"csi_sequences\":" << csiSequences
+       << ",\"osc_sequences\":" << oscSequences
+       << ",\"hyperlinks\":" << hyperlinks
+       << ",\"ignored_sequences\":" << ignoredSequences
+       << ",\"distinct_styles\":" << distinctStyles
+       << ",\"line_rewinds\":" << lineRewinds
+       << ",\"line_drops\":" << lineDrops
+       << ",\"time\":{\"total\":" << phaseJSON(total)
+       << ",\"read\":" << phaseJSON(read)
+       << ",\"render\":" << phaseJSON(render)
+       << ",\"write\":" << phaseJSON(write) << "}}\n";
+    return os.str();
+}
+
+}
@@ -0,0 +1,133 @@
+/***************************************************************************
+                          conversionstats.h  -  description
+                             -------------------
+    copyright            : (C) 2024 by Andre Simon
+    email                : a.simon@mailbox.org
+ ***************************************************************************/
+
+/*
+This file is part of ANSIFilter.
+
+ANSIFilter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ANSIFilter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef CONVERSIONSTATS_H
+#define CONVERSIONSTATS_H
+
+#include <cstdint>
+#include <string>
+
+/* Build with -DANSIFILTER_NO_STATS to remove the counters and timers from
+   the conversion code; getStats() then returns zeros. */
+#ifdef ANSIFILTER_NO_STATS
+#define AF_STATS_ENABLED 0
+#else
+#define AF_STATS_ENABLED 1
+#endif
+
+/// increment a counter of the ConversionStats member stats
+#define AF_COUNT(counter) do { if (AF_STATS_ENABLED) ++stats.counter; } while (0)
+
+/// add n to a counter of the ConversionStats member stats
+#define AF_ADD(counter, n) do { if (AF_STATS_ENABLED) stats.counter += (n); } while (0)
+
+namespace ansifilter
+{
+
+/** \brief Wall clock and CPU time spent in one phase of a conversion */
+
+struct PhaseTime {
+    double wall = 0.0;  ///< seconds
+    double cpu = 0.0;   ///< CPU seconds of the measuring thread, of all threads for the total
+};
+
+/** \brief Counters and timings of one conversion.
+
+    The counters are updated during every conversion, the timings and the
+    number of distinct styles only if CodeGenerator::setCollectStats() is
+    enabled. Render time is the part of the total time which was neither
+    spent reading nor writing; reading memory mapped input happens while
+    rendering.
+
+* @author Andre Simon
+*/
+
+struct ConversionStats {
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    uint64_t lines = 0;
+    uint64_t sgrSequences = 0;      ///< parsed SGR (formatting) sequences
+    uint64_t csiSequences = 0;      ///< CSI sequences other than SGR
+    uint64_t oscSequences = 0;      ///< OSC sequences, including hyperlinks
+    uint64_t hyperlinks = 0;        ///< OSC 8 hyperlinks
+    uint64_t ignoredSequences = 0;  ///< unknown or ignored escape sequences and control strings
+    uint64_t distinctStyles = 0;
+    uint64_t lineRewinds = 0;       ///< carriage returns which overwrite the line
+    uint64_t lineDrops = 0;         ///< lines dropped by K (erase line) sequences
+
+    PhaseTime total;
+    PhaseTime read;
+    PhaseTime render;
+    PhaseTime write;
+
+    /** \param name input name
+        \return human readable report, one value per line */
+    std::string toText(const std::string& name) const;
+
+    /** \param name input name
+        \return report as single line JSON object */
+    std::string toJSON(const std::string& name) const;
+
+    /** \return monotonic wall clock time in seconds */
+    static double wallClock();
+
+    /** \param thread true for the CPU time of the calling thread,
+                      false for the whole process
+        \return CPU time in seconds */
+    static double cpuClock(bool thread);
+};
+
+/** \brief Adds the time of its life span to a PhaseTime; does nothing if
+    the PhaseTime pointer is null. */
+
+class PhaseTimer
+{
+public:
+    explicit PhaseTimer(PhaseTime* t) : time(AF_STATS_ENABLED ? t : nullptr)
+    {
+        if (time) {
+            wallStart = ConversionStats::wallClock();
+            cpuStart = ConversionStats::cpuClock(true);
+        }
+    }
+
+    ~PhaseTimer()
+    {
+        if (time) {
+            time->wall += ConversionStats::wallClock() - wallStart;
+            time->cpu += ConversionStats::cpuClock(true) - cpuStart;
+        }
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    PhaseTime* time;
+    double wallStart = 0.0;
+    double cpuStart = 0.0;
+};
+
+}
+
+#endif
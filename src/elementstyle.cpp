@@ -23,74 +23,28 @@ along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "elementstyle.h"
-#include <iostream>
-namespace ansifilter
-{
-
-ElementStyle::ElementStyle()
-    : bold(false), italic(false), underline(false), blink(false),
-      reset(true), isNegativeMode(false), conceal(false), bgColorSet(false), fgColorSet(false),
-      fgColID(0),
-      bgColID(-1)
-{}
 
-ElementStyle::~ElementStyle() = default;
-
-bool ElementStyle::isItalic() const
-{
-    return italic;
-}
-bool ElementStyle::isBlink() const
-{
-    return blink;
-}
-bool ElementStyle::isBold() const
-{
-    return bold;
-}
-bool ElementStyle::isUnderline() const
-{
-    return underline;
-}
-bool ElementStyle::isConceal() const
-{
-    return conceal;
-}
-bool ElementStyle::isBgColorSet() const
-{
-    return bgColorSet;
-}
-bool ElementStyle::isFgColorSet() const
-{
-    return fgColorSet;
-}
-const StyleColour ElementStyle::getFgColour() const
-{
-    return fgColour;
-}
-const StyleColour ElementStyle::getBgColour() const
+namespace ansifilter
 {
-    return bgColour;
-}
 
 void  ElementStyle::imageMode(bool negative)
 {
-    if (negative !=isNegativeMode) {
+    if (negative != (bool)(attributes & NegativeMode)) {
         StyleColour swapCol=getFgColour();
         setFgColour(getBgColour());
         setBgColour(swapCol);
-        isNegativeMode=!isNegativeMode;
+        attributes ^= NegativeMode;
     }
 }
 
 void ElementStyle::setReset(bool b)
 {
-    reset=b;
-    if (reset) {
-      setFgColour("#000000");
+    setAttribute(Reset, b);
+    if (b) {
+      fgColour = StyleColour();
       setFgColourID(0);
       setBgColourID(-1);
-      bold = italic = underline = conceal = blink = bgColorSet = fgColorSet = false;
+      attributes &= Reset | NegativeMode;
     }
 }
 
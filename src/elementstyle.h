@@ -26,6 +26,8 @@ along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef ELEMENTSTYLE_H
 #define ELEMENTSTYLE_H
 
+#include <type_traits>
+
 #include "stylecolour.h"
 
 using std::string;
@@ -35,6 +37,9 @@ namespace ansifilter
 
 /** \brief The class stores the basic text formatting properties.
 
+    Colours are packed RGB values and the attributes are kept in a bitmask,
+    so the class is trivially copyable and cheap to compare and hash.
+
 * @author Andre Simon
 */
 
@@ -42,82 +47,112 @@ class ElementStyle
 {
 public:
 
-    ElementStyle();
-
-    ~ElementStyle();
+    ElementStyle()
+        : attributes(Reset),
+          fgColID(0),
+          bgColID(-1)
+    {
+    }
 
     /** \return True if italic */
-    bool isItalic() const;
+    bool isItalic() const
+    {
+        return attributes & Italic;
+    }
 
     /** \return True if italic */
-    bool isBlink() const;
+    bool isBlink() const
+    {
+        return attributes & Blink;
+    }
 
     /** \return True if bold */
-    bool isBold() const;
+    bool isBold() const
+    {
+        return attributes & Bold;
+    }
 
     /** \return True if underline */
-    bool isUnderline() const;
+    bool isUnderline() const
+    {
+        return attributes & Underline;
+    }
 
     /** \return True if concealed */
-    bool isConceal() const;
+    bool isConceal() const
+    {
+        return attributes & Conceal;
+    }
 
     /** \return True if background color should change */
-    bool isBgColorSet() const;
+    bool isBgColorSet() const
+    {
+        return attributes & BgColorSet;
+    }
 
     /** \return True if foreground color should change */
-    bool isFgColorSet() const;
+    bool isFgColorSet() const
+    {
+        return attributes & FgColorSet;
+    }
 
     /** \param b set blink flag */
     void setBlink(bool b)
     {
-        blink = b;
+        setAttribute(Blink, b);
     }
 
     /** \param b set italic flag */
     void setItalic(bool b)
     {
-        italic = b;
+        setAttribute(Italic, b);
     }
 
     /** \param b set conceal flag */
     void setConceal(bool b)
     {
-        conceal = b;
+        setAttribute(Conceal, b);
     }
 
     /** \param b set bold flag */
     void setBold(bool b)
     {
-        bold = b;
+        setAttribute(Bold, b);
     }
 
     /** \param b set underline flag */
     void setUnderline(bool b)
     {
-        underline = b;
+        setAttribute(Underline, b);
     }
 
     /** \return True if reset flag was set */
     bool isReset() const
     {
-        return reset;
+        return attributes & Reset;
     }
 
     /** \param b reset formatting parameters to defaults */
     void setReset(bool b);
 
     /** \return Foreground colour */
-    const StyleColour getFgColour() const;
+    const StyleColour& getFgColour() const
+    {
+        return fgColour;
+    }
 
     /** \return Background colour */
-    const StyleColour getBgColour() const;
+    const StyleColour& getBgColour() const
+    {
+        return bgColour;
+    }
 
     /** Set Foreground colour
         \param col colour of this element */
     void setFgColour(const StyleColour& col)
     {
         fgColour = col;
-        fgColorSet=true;
+        attributes |= FgColorSet;
     }
 
     /**   Set Background colour
@@ -125,26 +160,9 @@ public:
     void setBgColour(const StyleColour& col)
     {
         bgColour = col;
-        bgColorSet=true;
+        attributes |= BgColorSet;
     }
 
-    /** Set Foreground colour
-        \param col colour of this element */
-    void setFgColour(const string& rgbVal)
-    {
-        fgColour.setRGB(rgbVal);
-        fgColorSet=true;
-    }
-
-    /**   Set Background colour
-          \param col colour of this element */
-    void setBgColour(const string& rgbVal)
-    {
-        bgColour.setRGB(rgbVal);
-        bgColorSet=true;
-    }
-
-
     /** Set Foreground colour IF (RTF)
         \param col colour ID of this element */
     void setFgColourID(int id)
@@ -162,14 +180,14 @@ public:
 
     /** Set Foreground colour IF (RTF)
         \param col colour ID of this element */
-    int getFgColourID()
+    int getFgColourID() const
     {
         return fgColID;
     }
 
     /**   Set Background colour ID (RTF)
           \param col colour ID of this element */
-    int getBgColourID()
+    int getBgColourID() const
     {
         return bgColID;
     }
@@ -178,15 +196,69 @@ public:
         \param negative Set to true, to invert default colors, set to false, to invert them back to default*/
     void imageMode(bool negative=true);
 
+    /** \return hash value of all style properties */
+    size_t hash() const
+    {
+        uint64_t h = (uint64_t)fgColour.getRGB() << 32 | bgColour.getRGB();
+        h ^= ((uint64_t)attributes << 16 | (uint8_t)fgColID << 8 | (uint8_t)bgColID) * 0x9e3779b97f4a7c15ULL;
+        return (size_t)(h ^ (h >> 29));
+    }
+
+    bool operator==(const ElementStyle& r) const
+    {
+        return fgColour==r.fgColour && bgColour==r.bgColour && attributes==r.attributes
+               && fgColID==r.fgColID && bgColID==r.bgColID;
+    }
+
+    bool operator!=(const ElementStyle& r) const
+    {
+        return !(*this==r);
+    }
+
 private:
+
+    /// attribute flags
+    enum Attribute : uint16_t {
+        Bold         = 1<<0,
+        Italic       = 1<<1,
+        Underline    = 1<<2,
+        Blink        = 1<<3,
+        Conceal      = 1<<4,
+        Reset        = 1<<5,
+        NegativeMode = 1<<6,
+        BgColorSet   = 1<<7,
+        FgColorSet   = 1<<8
+    };
+
+    void setAttribute(Attribute a, bool b)
+    {
+        if (b)
+            attributes |= a;
+        else
+            attributes &= ~a;
+    }
+
     StyleColour fgColour;
     StyleColour bgColour;
-    bool bold, italic, underline, blink;
-    bool reset;
-    bool isNegativeMode, conceal;
-    bool bgColorSet, fgColorSet;
-    int fgColID;
-    int bgColID;
+    uint16_t attributes;
+    int8_t fgColID;
+    int8_t bgColID;
+};
+
+static_assert(std::is_trivially_copyable<ElementStyle>::value, "ElementStyle is copied per character in art modes");
+
+}
+
+namespace std
+{
+
+template<>
+struct hash<ansifilter::ElementStyle>
+{
+    size_t operator()(const ansifilter::ElementStyle& style) const
+    {
+        return style.hash();
+    }
 };
 
 }
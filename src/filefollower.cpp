@@ -0,0 +1,294 @@
+/***************************************************************************
+                          filefollower.cpp  -  description
+                             -------------------
+    copyright            : (C) 2024 by Andre Simon
+    email                : a.simon@mailbox.org
+ ***************************************************************************/
+
+/*
+This file is part of ANSIFilter.
+
+ANSIFilter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ANSIFilter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "filefollower.h"
+
+#include <vector>
+#include <cstring>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/vfs.h>
+#endif
+
+namespace ansifilter
+{
+
+#ifdef __linux__
+/** \return true if changes of other hosts are not reported by inotify */
+static bool isRemoteFileSystem(int fd)
+{
+    struct statfs fs;
+    if (fstatfs(fd, &fs) != 0) {
+        return true;
+    }
+    switch ((unsigned long)fs.f_type) {
+    case 0x6969:       // NFS
+    case 0x517B:       // SMB
+    case 0xFF534D42:   // CIFS
+    case 0xFE534D42:   // SMB2
+    case 0x65735546:   // FUSE
+    case 0x01021997:   // 9P
+    case 0x00C36400:   // Ceph
+    case 0x5346414F:   // AFS
+        return true;
+    default:
+        return false;
+    }
+}
+#endif
+
+FileFollower::FileFollower()
+    : fd(-1),
+      inotifyFd(-1),
+      fileWatch(-1),
+      device(0),
+      inode(0)
+{
+}
+
+FileFollower::~FileFollower()
+{
+    close();
+}
+
+bool FileFollower::open(const std::string& fileName)
+{
+    close();
+#ifdef WIN32
+    (void)fileName;
+    return false;
+#else
+    fd = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close();
+        return false;
+    }
+    path = fileName;
+    device = st.st_dev;
+    inode = st.st_ino;
+
+    addWatches();
+    return true;
+#endif
+}
+
+void FileFollower::close()
+{
+#ifndef WIN32
+    if (inotifyFd >= 0) {
+        ::close(inotifyFd);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+#endif
+    fd = inotifyFd = fileWatch = -1;
+    path.clear();
+}
+
+bool FileFollower::addWatches()
+{
+#ifdef __linux__
+    if (isRemoteFileSystem(fd)) {
+        return false;
+    }
+
+    inotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (inotifyFd < 0) {
+        return false;
+    }
+
+    // IN_ATTRIB reports the deletion while the file is still open
+    fileWatch = inotify_add_watch(inotifyFd, path.c_str(),
+                                  IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+
+    // the directory reports the new file of a rotation
+    std::string::size_type sep = path.find_last_of('/');
+    std::string dir = (sep == std::string::npos) ? "." : path.substr(0, sep + 1);
+    int dirWatch = inotify_add_watch(inotifyFd, dir.c_str(), IN_CREATE | IN_MOVED_TO);
+
+    if (fileWatch < 0 || dirWatch < 0) {
+        ::close(inotifyFd);
+        inotifyFd = fileWatch = -1;
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void FileFollower::seekTail(off_t maxSize, off_t tailSize)
+{
+#ifndef WIN32
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size <= maxSize) {
+        lseek(fd, 0, SEEK_SET);
+        return;
+    }
+
+    // skip the line fragment at the beginning of the tail
+    std::vector<char> tail(tailSize);
+    off_t start = size - tailSize;
+    ssize_t n = pread(fd, tail.data(), tail.size(), start);
+    const char* nl = n > 0 ? static_cast<const char*>(memchr(tail.data(), '\n', n)) : nullptr;
+    lseek(fd, nl ? start + (nl - tail.data()) + 1 : size, SEEK_SET);
+#else
+    (void)maxSize;
+    (void)tailSize;
+#endif
+}
+
+off_t FileFollower::seekTailLines(size_t lines)
+{
+#ifndef WIN32
+    const off_t blockSize = 65536;
+    off_t size = lseek(fd, 0, SEEK_END);
+    off_t start = 0;
+    size_t found = 0;
+    std::vector<char> block(blockSize);
+
+    // the line break at the end of the file does not begin another line
+    off_t end = size;
+    char last = 0;
+    if (end > 0 && pread(fd, &last, 1, end - 1) == 1 && last == '\n') {
+        --end;
+    }
+
+    if (lines == 0) {
+        start = size;
+    }
+    while (found < lines && end > 0) {
+        off_t begin = end > blockSize ? end - blockSize : 0;
+        if (pread(fd, block.data(), end - begin, begin) != end - begin) {
+            break;
+        }
+        for (off_t i = end - begin; i > 0; --i) {
+            if (block[i - 1] == '\n' && ++found == lines) {
+                start = begin + i;
+                break;
+            }
+        }
+        end = begin;
+    }
+    lseek(fd, start, SEEK_SET);
+    return start;
+#else
+    (void)lines;
+    return 0;
+#endif
+}
+
+bool FileFollower::readAt(off_t offset, size_t size, std::string& data) const
+{
+    data.resize(size);
+#ifndef WIN32
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = pread(fd, &data[done], size - done, offset + done);
+        if (n <= 0) {
+            break;
+        }
+        done += n;
+    }
+    data.resize(done);
+    return done == size;
+#else
+    (void)offset;
+    data.clear();
+    return false;
+#endif
+}
+
+bool FileFollower::isReplaced() const
+{
+#ifndef WIN32
+    struct stat st;
+    // a deleted file may not be recreated yet, keep the old one meanwhile
+    return stat(path.c_str(), &st) == 0 && (st.st_dev != device || st.st_ino != inode);
+#else
+    return false;
+#endif
+}
+
+bool FileFollower::waitForData()
+{
+#ifndef WIN32
+    while (fd >= 0) {
+        struct stat st;
+        off_t pos = lseek(fd, 0, SEEK_CUR);
+        if (fstat(fd, &st) == 0) {
+            if (st.st_size > pos) {
+                return false;
+            }
+            if (st.st_size < pos) {
+                // copytruncate
+                lseek(fd, 0, SEEK_SET);
+                return true;
+            }
+        }
+
+        // the old file was read completely, continue with the new one
+        if (isReplaced()) {
+            int oldFd = fd;
+            fd = -1;
+            std::string fileName = path;
+            if (open(fileName)) {
+                ::close(oldFd);
+                return true;
+            }
+            fd = oldFd;
+            path = fileName;
+            addWatches();
+        }
+
+        if (inotifyFd >= 0) {
+            struct pollfd pfd = { inotifyFd, POLLIN, 0 };
+            if (poll(&pfd, 1, -1) > 0) {
+                // the state is checked again, the events themselves are not needed
+                char events[4096];
+                while (read(inotifyFd, events, sizeof(events)) > 0) {
+                }
+            }
+        } else {
+            sleep(1);
+        }
+    }
+#endif
+    return false;
+}
+
+}
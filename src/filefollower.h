@@ -0,0 +1,114 @@
+/***************************************************************************
+                          filefollower.h  -  description
+                             -------------------
+    copyright            : (C) 2024 by Andre Simon
+    email                : a.simon@mailbox.org
+ ***************************************************************************/
+
+/*
+This file is part of ANSIFilter.
+
+ANSIFilter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ANSIFilter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef FILEFOLLOWER_H
+#define FILEFOLLOWER_H
+
+#include <string>
+#include <sys/types.h>
+
+namespace ansifilter
+{
+
+/** \brief Follows a growing file like tail -F.
+
+    Appended data is awaited with inotify where available; on other
+    platforms, on network file systems and if inotify fails, the file is
+    polled once a second. Log rotation is detected: if the path refers to
+    a new file (rename or delete and create), the old file is read to its
+    end and the new one is opened; if the file was truncated (copytruncate),
+    reading starts again at the beginning.
+
+* @author Andre Simon
+*/
+
+class FileFollower
+{
+public:
+
+    FileFollower();
+
+    ~FileFollower();
+
+    /** Open a file, closing the previous one
+        \param fileName file path
+        \return true if the file was opened; false also on platforms
+                without support, the caller should read a stream instead */
+    bool open(const std::string& fileName);
+
+    /** Close the file and remove the watches */
+    void close();
+
+    /** \return file descriptor to read from, -1 if no file is open */
+    int getDescriptor() const
+    {
+        return fd;
+    }
+
+    /** Position the descriptor before the tail of the file: if the file is
+        larger than maxSize, reading starts with the first complete line of
+        the last tailSize bytes
+        \param maxSize files up to this size are read completely
+        \param tailSize size of the tail */
+    void seekTail(off_t maxSize, off_t tailSize);
+
+    /** Position the file at the beginning of its last lines. The file is read
+        backwards in blocks, so the effort does not depend on the file size.
+        \param lines number of lines
+        \return new file position */
+    off_t seekTailLines(size_t lines);
+
+    /** Read a part of the file without changing the file position
+        \param offset begin of the part
+        \param size size of the part
+        \param data receives the data read
+        \return true if the part was read completely */
+    bool readAt(off_t offset, size_t size, std::string& data) const;
+
+    /** Wait until more data may be read; call this after a read returned EOF.
+        \return true if the descriptor was replaced or repositioned (rotation
+                or truncation), buffered input should be discarded */
+    bool waitForData();
+
+private:
+    FileFollower(const FileFollower&) = delete;
+    FileFollower& operator=(const FileFollower&) = delete;
+
+    /** add inotify watches for the open file and its directory
+        \return false if the file has to be polled */
+    bool addWatches();
+
+    /** \return true if the path refers to another file than the open one */
+    bool isReplaced() const;
+
+    std::string path;
+    int fd;
+    int inotifyFd;       ///< inotify instance, -1 if the file is polled
+    int fileWatch;       ///< watch of the open file
+    dev_t device;        ///< identity of the open file
+    ino_t inode;
+};
+
+}
+
+#endif
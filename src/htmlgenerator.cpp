@@ -36,6 +36,21 @@ along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
 namespace ansifilter
 {
 
+/// replacement strings of HTML special characters
+static constexpr EscapeTable makeHtmlEscapeTable()
+{
+    EscapeTable table = makeEscapeTable();
+    table['<'] = "&lt;";
+    table['>'] = "&gt;";
+    table['&'] = "&amp;";
+    table['\"'] = "&quot;";
+    table['\''] = "&apos;";
+    table['@'] = "&#64;";
+    return table;
+}
+
+static constexpr EscapeTable htmlEscapeTable = makeHtmlEscapeTable();
+
 HtmlGenerator::HtmlGenerator ():
     CodeGenerator(HTML),
     fileSuffix(".html")
@@ -44,6 +59,7 @@ HtmlGenerator::HtmlGenerator ():
     styleCommentOpen="/*";
     styleCommentClose="*/";
     spacer=" ";
+    escapeTable = &htmlEscapeTable;
 }
 
 string HtmlGenerator::getOpenTag()
@@ -54,32 +70,7 @@ string HtmlGenerator::getOpenTag()
     if (applyDynStyles){
         attrName = "class";
 
-        ostringstream fgColStream;
-         if (elementStyle.isFgColorSet()) {
-            fgColStream << elementStyle.getFgColour().getRed(HTML)
-                        << elementStyle.getFgColour().getGreen(HTML)
-                        << elementStyle.getFgColour().getBlue(HTML);
-         }
-
-        ostringstream bgColStream;
-        if (elementStyle.isBgColorSet()) {
-
-            bgColStream << elementStyle.getBgColour().getRed(HTML)
-                        << elementStyle.getBgColour().getGreen(HTML)
-                        << elementStyle.getBgColour().getBlue(HTML);
-        }
-
-        StyleInfo sInfo( fgColStream.str(), bgColStream.str(),
-                         elementStyle.isBold(), elementStyle.isItalic(), elementStyle.isConceal(),
-                         elementStyle.isBlink(), elementStyle.isUnderline() );
-
-        auto fit = std::find(documentStyles.begin(), documentStyles.end(), sInfo );
-        if (fit == documentStyles.end()){
-            documentStyles.push_back(sInfo);
-            fmtStream << "af_"<< documentStyles.size();
-        } else {
-            fmtStream << "af_"<< 1+(int)std::distance(documentStyles.begin(), fit);
-        }
+        fmtStream << "af_"<< registerDocumentStyle( StyleInfo( elementStyle ) );
 
     } else {
 
@@ -187,7 +178,7 @@ string HtmlGenerator::getHeader()
 string HtmlGenerator::getFooter()
 {
     string footer;
-    footer += getCloseTag();
+    footer += closeTag();
     footer += "</pre>\n</body>\n</html>\n";
 
      if (!omitVersionInfo)
@@ -203,28 +194,20 @@ void HtmlGenerator::printBody()
 
 void HtmlGenerator::insertLineNumber ()
 {
-  if ( showLineNumbers && !parseCP437) {
+  if ( showLineNumbers && !parseCP437 && numberCurrentLine) {
 
-        ostringstream lnum;
-        lnum << setw ( 5 ) << right;
-        if ( numberCurrentLine ) {
+        if (addFunnyAnchors)
+            *out << "<a href=\"#l_" << lineNumber<< "\"";
+        else
+            *out << "<span";
 
-            lnum << lineNumber;
-            if (addFunnyAnchors)
-                *out << "<a href=\"#l_" << lineNumber<< "\"";
-            else
-                *out << "<span";
-
-            if (addAnchors) {
-                *out << " id=\"l_" << lineNumber<< "\" ";
-            }
-            *out << " class=\"af_line\">";
-
-            *out <<lnum.str() << ( addFunnyAnchors  ? "</a> " : "</span> ");
-        } else {
-            *out << lnum.str(); //for indentation
+        if (addAnchors) {
+            *out << " id=\"l_" << lineNumber<< "\" ";
         }
-    }
+        *out << " class=\"af_line\">";
+
+        *out << formatLineNumber() << ( addFunnyAnchors  ? "</a> " : "</span> ");
+  }
 }
 
 string HtmlGenerator::getHyperlink(std::string_view uri, std::string_view txt){
@@ -244,9 +227,10 @@ bool HtmlGenerator::printDynamicStyleFile ( const string &outPath ) {
     if ( !indexfile.fail() ) {
         indexfile << "/* CSS generated by ansifilter - styles derived from document formatting\n   Ansifilter will not overwrite this file\n*/\n";
 
+        const vector<StyleInfo> documentStyles = styleRegistry->getStyles();
         for (unsigned int i=0; i<documentStyles.size();i++){
             StyleInfo sInfo = documentStyles[i];
-            indexfile << "span.af_" << (i+1) <<" {";
+            indexfile << "span.af_" << styleRegistry->getClassNumber(sInfo) <<" {";
 
             if (sInfo.isBold) {
                 indexfile<< "font-weight:bold;";
@@ -264,15 +248,19 @@ bool HtmlGenerator::printDynamicStyleFile ( const string &outPath ) {
                 indexfile<< "display:none;";
             }
 
-            if (sInfo.fgColor.length()) {
+            if (sInfo.isFgColorSet) {
                 indexfile << "color:#"
-                          << sInfo.fgColor
+                          << sInfo.fgColour.getRed(HTML)
+                          << sInfo.fgColour.getGreen(HTML)
+                          << sInfo.fgColour.getBlue(HTML)
                           << ";";
             }
 
-            if (sInfo.bgColor.length()) {
+            if (sInfo.isBgColorSet) {
                 indexfile << "background-color:#"
-                          << sInfo.bgColor
+                          << sInfo.bgColour.getRed(HTML)
+                          << sInfo.bgColour.getGreen(HTML)
+                          << sInfo.bgColour.getBlue(HTML)
                           << ";";
             }
 
@@ -286,41 +274,6 @@ bool HtmlGenerator::printDynamicStyleFile ( const string &outPath ) {
     return true;
 }
 
-string HtmlGenerator::maskCharacter(unsigned char c)
-{
-    switch (c) {
-    case '<' :
-        return "&lt;";
-        break;
-    case '>' :
-        return "&gt;";
-        break;
-    case '&' :
-        return "&amp;";
-        break;
-    case '\"' :
-        return "&quot;";
-        break;
-    case '\'' :
-      return "&apos;";
-      break;
-    case '\t' : // see deletion of nonprintable chars below
-        return "\t";
-        break;
-
-    case '@' :
-        return "&#64;";
-        break;
-
-    default :
-        if (c>0x1f ) { // printable?
-            return  string( 1, c );
-        } else {
-            return "";
-        }
-    }
-}
-
 std::string HtmlGenerator::maskCP437Character(unsigned char c) {
     static const std::unordered_map<unsigned char, std::string> charMap = {
         {0x00, " "},
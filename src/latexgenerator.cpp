@@ -34,6 +34,35 @@ along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
 namespace ansifilter
 {
 
+/// replacement strings of LaTeX special characters
+static constexpr EscapeTable makeLatexEscapeTable()
+{
+    EscapeTable table = makeEscapeTable();
+    table[' '] = "\\ws{\\ }";
+    table['<'] = "$<$";
+    table['>'] = "$>$";
+    table['{'] = "\\{";
+    table['}'] = "\\}";
+    table['&'] = "\\&";
+    table['$'] = "\\$";
+    table['#'] = "\\#";
+    table['%'] = "\\%";
+    table['_'] = "\\textunderscore ";
+    table['^'] = "\\textasciicircum ";
+    table['\\'] = "$\\backslash$";
+    table['~'] = "$\\sim$";
+    table['|'] = "\\textbar ";
+    // avoid latex compilation failure if [ or * follows a line break (\\)
+    table['*'] = "{*}";
+    table['['] = "{[}";
+    table[']'] = "{]}";
+    // avoid "merging" of consecutive '-' chars when included in bold font ( \bf )
+    table['-'] = "{-}";
+    return table;
+}
+
+static constexpr EscapeTable latexEscapeTable = makeLatexEscapeTable();
+
 LaTeXGenerator::LaTeXGenerator ():
     CodeGenerator(LATEX),
     fileSuffix(".tex")
@@ -42,6 +71,7 @@ LaTeXGenerator::LaTeXGenerator ():
     styleCommentOpen="/*";
     styleCommentClose="*/";
     spacer="\\ws{\\ }";
+    escapeTable = &latexEscapeTable;
 }
 
 string LaTeXGenerator::getOpenTag()
@@ -124,91 +154,13 @@ void LaTeXGenerator::printBody()
     processInput();
 }
 
-string LaTeXGenerator::maskCharacter(unsigned char c)
-{
-
-    switch (c) {
-
-    case ' ':
-        return spacer;
-        break;
-    case '<' :
-        return "$<$";
-        break;
-    case '>' :
-        return "$>$";
-        break;
-    case '{':
-    case '}':
-    case '&':
-    case '$':
-    case '#':
-    case '%': {
-        string m( "\\" );
-        m += c;
-        return m;
-    }
-    break;
-    // case '\"':
-    //  return (fragmentOutput && replaceQuotes)?"\\dq{}":"\"";
-    //   break;
-    case '_':
-        return "\\textunderscore ";
-        break;
-    case '^':
-        return "\\textasciicircum ";
-        break;
-    case '\\':
-        return "$\\backslash$";
-        break;
-    case '~':
-        return "$\\sim$";
-        break;
-    case '|':
-        return "\\textbar ";
-        break;
-    // avoid latex compilation failure if [ or * follows a line break (\\)
-    case '*':
-    case '[':
-    case ']':
-    // avoid "merging" of consecutive '-' chars when included in bold font ( \bf )
-    case '-': {
-        string m( 1, '{' );
-        m += c;
-        m += '}';
-        return m;
-    }
-    break;
-
-    case '\t' : // see deletion of nonprintable chars below
-        return "\t";
-        break;
-
-    default :
-        if (c>0x1f ) { // printable?
-            return string( 1, c );;
-        } else {
-            return "";
-        }
-    }
-
-}
-
 void LaTeXGenerator::insertLineNumber ()
 {
-    if ( showLineNumbers ) {
-
-        ostringstream lnum;
-        lnum << setw ( 5 ) << right;
-        if( numberCurrentLine ) {
-            if (lineNumber>1)
-              *out << getCloseTag();
-            lnum << lineNumber;
-            *out <<"{\\color[rgb]{0,0,0} "<<lnum.str()<<"}"<<spacer;
-            *out << getOpenTag();
-        } else {
-            *out << lnum.str(); //for indentation
-        }
+    if ( showLineNumbers && numberCurrentLine ) {
+        if (lineNumber>1)
+          *out << closeTag();
+        *out <<"{\\color[rgb]{0,0,0} "<<formatLineNumber()<<"}"<<spacer;
+        *out << openTag();
     }
 }
 
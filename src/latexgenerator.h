@@ -75,9 +75,6 @@ private:
     /** Print document footer*/
     string getFooter();
 
-    /** \return escaped character*/
-    virtual string maskCharacter(unsigned char );
-
     virtual string getHyperlink(std::string_view uri, std::string_view txt);
 
     void insertLineNumber();
@@ -0,0 +1,109 @@
+/***************************************************************************
+                          linebuffer.h  -  description
+                             -------------------
+    copyright            : (C) 2024 by Andre Simon
+    email                : a.simon@mailbox.org
+ ***************************************************************************/
+
+/*
+This file is part of ANSIFilter.
+
+ANSIFilter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ANSIFilter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef LINEBUFFER_H
+#define LINEBUFFER_H
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+namespace ansifilter
+{
+
+/** \brief Collects the output of the current line.
+
+    The buffer keeps its capacity when it is cleared, so converting a file
+    does not allocate memory for every line. Like an ostringstream, it has a
+    write position which may be moved back to the line start (i.e. after a
+    carriage return); following output overwrites the previous content.
+
+* @author Andre Simon
+*/
+
+class LineBuffer
+{
+public:
+
+    LineBuffer(): pos(0) {}
+
+    /** Write bytes at the current write position
+        \param s bytes
+        \param n number of bytes */
+    void append(const char* s, size_t n)
+    {
+        if (pos==buffer.size()) {
+            buffer.append(s, n);
+        } else {
+            size_t overwrite = std::min(n, buffer.size()-pos);
+            buffer.replace(pos, overwrite, s, overwrite);
+            buffer.append(s+overwrite, n-overwrite);
+        }
+        pos+=n;
+    }
+
+    LineBuffer& operator<<(std::string_view s)
+    {
+        append(s.data(), s.size());
+        return *this;
+    }
+
+    /** Move the write position to the beginning, keeping the content */
+    void rewind()
+    {
+        pos = 0;
+    }
+
+    /** Remove the content, keeping the allocated memory */
+    void clear()
+    {
+        buffer.clear();
+        pos = 0;
+    }
+
+    /** \return current write position */
+    size_t getWritePosition() const
+    {
+        return pos;
+    }
+
+    /** \return complete content; valid until the next modification */
+    std::string_view view() const
+    {
+        return std::string_view(buffer);
+    }
+
+    /** \return content up to the write position; valid until the next modification */
+    std::string_view writtenView() const
+    {
+        return std::string_view(buffer.data(), pos);
+    }
+
+private:
+    std::string buffer;
+    size_t pos;          ///< write position
+};
+
+}
+
+#endif
@@ -0,0 +1,238 @@
+/***************************************************************************
+                          linereader.cpp  -  description
+                             -------------------
+    copyright            : (C) 2024 by Andre Simon
+    email                : a.simon@mailbox.org
+ ***************************************************************************/
+
+/*
+This file is part of ANSIFilter.
+
+ANSIFilter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ANSIFilter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "linereader.h"
+#include "outputsink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace ansifilter
+{
+
+LineReader::LineReader(size_t size)
+    : blockSize(size),
+      pos(0),
+      end(0),
+      searched(0),
+      eof(false),
+      in(nullptr),
+      fd(-1),
+      memory(nullptr),
+      pushed(false),
+      tiedSink(nullptr),
+      bytesRead(0),
+      readTime(nullptr)
+{
+}
+
+void LineReader::setStream(std::istream* s)
+{
+    reset();
+    in = s;
+    fd = -1;
+    memory = nullptr;
+    pushed = false;
+}
+
+void LineReader::setFileDescriptor(int d)
+{
+    reset();
+    in = nullptr;
+    fd = d;
+    memory = nullptr;
+    pushed = false;
+}
+
+void LineReader::setMemory(const char* data, size_t size)
+{
+    reset();
+    in = nullptr;
+    fd = -1;
+    memory = data;
+    pushed = false;
+    end = size;
+    eof = true;
+}
+
+void LineReader::beginPush()
+{
+    reset();
+    in = nullptr;
+    fd = -1;
+    memory = nullptr;
+    pushed = true;
+}
+
+size_t LineReader::push(const char* data, size_t size)
+{
+    if (buffer.size()!=blockSize) {
+        buffer.resize(blockSize);
+    }
+
+    // make room behind the unprocessed data
+    if (pos) {
+        if (pos<end) memmove(buffer.data(), buffer.data() + pos, end-pos);
+        end -= pos;
+        searched = searched>pos ? searched-pos : 0;
+        pos = 0;
+    }
+
+    size_t cnt = std::min(size, blockSize - end);
+    memcpy(buffer.data() + end, data, cnt);
+    end += cnt;
+    bytesRead += cnt;
+    return cnt;
+}
+
+void LineReader::reset()
+{
+    pos = end = searched = 0;
+    eof = false;
+}
+
+bool LineReader::fill()
+{
+    if (buffer.size()!=blockSize) {
+        buffer.resize(blockSize);
+    }
+
+    size_t len = blockSize - end;
+    size_t cnt = 0;
+
+    if (fd>=0) {
+        if (tiedSink) tiedSink->flush();
+        long n = 0;
+        PhaseTimer timer(readTime);
+        do {
+            n = ::read(fd, buffer.data() + end, len);
+        } while (n<0 && errno==EINTR);
+        if (n>0) cnt = n;
+    } else if (in) {
+        PhaseTimer timer(readTime);
+        in->read(buffer.data() + end, len);
+        cnt = in->gcount();
+        // a short read means we reached the end of the stream
+        if (cnt<len) eof = true;
+    }
+
+    if (!cnt) eof = true;
+    end += cnt;
+    bytesRead += cnt;
+    return cnt>0;
+}
+
+bool LineReader::nextSegment(std::string_view& segment, bool& lineEnd)
+{
+    if (memory) {
+        return nextMemorySegment(segment, lineEnd);
+    }
+
+    while (true) {
+        if (pos<end) {
+            // an incomplete line is not searched again after each read
+            const char* start = buffer.data() + pos;
+            size_t from = std::max(pos, searched);
+            const char* nl = static_cast<const char*>(memchr(buffer.data() + from, '\n', end-from));
+            if (nl) {
+                segment = std::string_view(start, nl-start);
+                pos += segment.size() + 1;
+                searched = pos;
+                lineEnd = true;
+                return true;
+            }
+            searched = end;
+        }
+
+        if (eof) {
+            // last line without terminating newline
+            if (pos<end) {
+                segment = std::string_view(buffer.data() + pos, end-pos);
+                pos = end;
+                lineEnd = true;
+                return true;
+            }
+            return false;
+        }
+
+        // move the incomplete line to the beginning of the buffer
+        if (pos) {
+            if (pos<end) memmove(buffer.data(), buffer.data() + pos, end-pos);
+            end -= pos;
+            searched -= pos;
+            pos = 0;
+        }
+
+        // the line does not fit into the buffer
+        if (end && end==blockSize) {
+            segment = std::string_view(buffer.data(), end);
+            pos = end;
+            lineEnd = false;
+            return true;
+        }
+
+        // wait for the next push()
+        if (pushed) {
+            return false;
+        }
+
+        fill();
+    }
+}
+
+bool LineReader::nextMemorySegment(std::string_view& segment, bool& lineEnd)
+{
+    if (pos>=end) {
+        return false;
+    }
+
+    // split lines like the block buffer would to keep the output buffer small
+    const char* start = memory + pos;
+    size_t len = std::min(end-pos, blockSize);
+    const char* nl = static_cast<const char*>(memchr(start, '\n', len));
+    if (nl) {
+        segment = std::string_view(start, nl-start);
+        pos += segment.size() + 1;
+        lineEnd = true;
+    } else {
+        segment = std::string_view(start, len);
+        pos += len;
+        lineEnd = (pos==end);
+    }
+    return true;
+}
+
+void LineReader::keepTail(size_t len)
+{
+    pos -= (len<pos) ? len : pos;
+}
+
+}
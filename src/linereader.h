@@ -0,0 +1,180 @@
+/***************************************************************************
+                          linereader.h  -  description
+                             -------------------
+    copyright            : (C) 2024 by Andre Simon
+    email                : a.simon@mailbox.org
+ ***************************************************************************/
+
+/*
+This file is part of ANSIFilter.
+
+ANSIFilter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ANSIFilter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LINEREADER_H
+#define LINEREADER_H
+
+#include <istream>
+#include <string_view>
+#include <vector>
+
+#include "conversionstats.h"
+
+namespace ansifilter
+{
+
+class OutputSink;
+
+/** \brief Reads input in fixed size blocks and returns it line by line.
+
+    Lines which do not fit into the block buffer are returned as a sequence
+    of segments, so the memory usage is bounded by the block size and not by
+    the longest input line. The caller may hand back the tail of a segment
+    with keepTail() if it has to be parsed together with the following data
+    (i.e. an escape sequence which is split between two blocks).
+
+* @author Andre Simon
+*/
+
+class LineReader
+{
+public:
+
+    /// default size of the block buffer
+    static const size_t defaultBlockSize = 256*1024;
+
+    /** \param blockSize size of the block buffer */
+    explicit LineReader(size_t blockSize=defaultBlockSize);
+
+    /** read from an input stream
+        \param s input stream */
+    void setStream(std::istream* s);
+
+    /** read from a file descriptor; read() returns as soon as some data is
+        available, which keeps pipes interactive
+        \param fd file descriptor */
+    void setFileDescriptor(int fd);
+
+    /** read data which is passed with push(); until finishPush() is called,
+        nextSegment() returns false if no complete line is buffered */
+    void beginPush();
+
+    /** Append input data in push mode
+        \param data input bytes
+        \param size number of bytes
+        \return number of bytes copied, less than size if the buffer is full */
+    size_t push(const char* data, size_t size);
+
+    /** \return true if the input is passed with push() */
+    bool isPushed() const
+    {
+        return pushed;
+    }
+
+    /** Mark the end of the pushed input */
+    void finishPush()
+    {
+        eof = true;
+    }
+
+    /** \return size of the block buffer */
+    size_t getBlockSize() const
+    {
+        return blockSize;
+    }
+
+    /** read from memory, i.e. a memory mapped file; segments point directly
+        into this memory
+        \param data input bytes, must be valid as long as they are read
+        \param size number of bytes */
+    void setMemory(const char* data, size_t size);
+
+    /** Get the next line or line segment. Segments are only valid until the
+        next call.
+        \param segment receives line content without the terminating newline
+        \param lineEnd set to false if the segment does not end the line
+        \return false if no more data is available */
+    bool nextSegment(std::string_view& segment, bool& lineEnd);
+
+    /** Return the last bytes of the previous segment to the reader; they will
+        be the beginning of the next segment
+        \param len number of bytes */
+    void keepTail(size_t len);
+
+    /** Flush an output sink before data is read from a file descriptor, so
+        output of an interactive pipe is not delayed (like std::cin is tied
+        to std::cout)
+        \param sink output sink, nullptr to remove the tie */
+    void tie(OutputSink* sink)
+    {
+        tiedSink = sink;
+    }
+
+    /** \return offset of the next segment in the memory input */
+    size_t getMemoryOffset() const
+    {
+        return pos;
+    }
+
+    /** Reset the end-of-file state to continue reading a growing input */
+    void clearEOF()
+    {
+        eof = false;
+    }
+
+    /** \return number of bytes read from streams, file descriptors and push();
+        memory input is not counted */
+    uint64_t getBytesRead() const
+    {
+        return bytesRead;
+    }
+
+    /** Measure the time spent waiting for input
+        \param t receives the read times, nullptr to stop measuring */
+    void setReadTimer(PhaseTime* t)
+    {
+        readTime = t;
+    }
+
+    /** Drop buffered data and reset the reader state */
+    void reset();
+
+private:
+
+    /** read more data into the buffer
+        \return false if no data was read */
+    bool fill();
+
+    /** nextSegment() implementation for memory input */
+    bool nextMemorySegment(std::string_view& segment, bool& lineEnd);
+
+    std::vector<char> buffer;
+    size_t blockSize;
+    size_t pos;          ///< start of unprocessed data
+    size_t end;          ///< end of valid data
+    size_t searched;     ///< data from pos up to here contains no newline
+    bool eof;
+
+    std::istream* in;
+    int fd;
+    const char* memory;  ///< memory input, or nullptr
+    bool pushed;         ///< input is passed with push()
+    OutputSink* tiedSink;
+    uint64_t bytesRead;
+    PhaseTime* readTime;
+};
+
+}
+
+#endif
@@ -28,7 +28,10 @@ You should have received a copy of the GNU General Public License
 along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <thread>
 #include "main.h"
 #include "codegenerator.h"
 #include "platform_fs.h"
@@ -60,9 +63,20 @@ void ANSIFilterApp::printHelp()
     cout << "  -i, --input=<file>     Name of input file (default stdin)\n";
     cout << "  -o, --output=<file>    Name of output file (default stdout)\n";
     cout << "  -O, --outdir=<dir>     Name of output directory\n";
+    cout << "  -j, --jobs=<n>         Convert multiple input files in n threads (0: number of CPUs);\n";
+    cout << "                         a single input file is split into chunks\n";
     cout << "  -t, --tail             Continue reading after end-of-file (like tail -f)\n";
+    cout << "      --tail-lines=<n>   Print the last n lines of the input file, then continue\n";
+    cout << "                         reading (like tail -n n -f)\n";
     cout << "  -x, --max-size=<size>  Set maximum input file size\n";
     cout << "                         (examples: 512M, 1G; default: 256M)\n";
+    cout << "      --buffer-size=<s>  Set output buffer size (examples: 64K, 1M; default: 256K)\n";
+    cout << "      --no-mmap          Read input files as stream instead of mapping them into memory\n";
+    cout << "      --chunk-size=<s>   Set minimum chunk size of a single input file converted\n";
+    cout << "                         with --jobs (examples: 64M, 1G; default: 8M)\n";
+#ifndef ANSIFILTER_NO_STATS
+    cout << "      --stats(=json)     Print conversion statistics of each input file to stderr\n";
+#endif
     cout << "\nOutput text formats:\n";
     cout << "  -T, --text (default)   Output text\n";
     cout << "  -H, --html             Output HTML\n";
@@ -118,6 +132,145 @@ void ANSIFilterApp::printHelp()
     cout << "For updates see " << Info::getWebsite()<< "\n";
 }
 
+bool ANSIFilterApp::initGenerator(ansifilter::CodeGenerator* generator, const CmdLineOptions& options)
+{
+    if (!options.omitDefaultForegroundColor()) {
+        generator->setDefaultForegroundColor();
+    }
+
+    if (!generator->setColorMap(options.getMapPath())){
+        return false;
+    }
+
+    generator->setEncoding(options.getEncoding());
+    generator->setFragmentCode(options.fragmentOutput());
+    generator->setPlainOutput(options.plainOutput());
+    generator->setContinueReading(options.ignoreInputEOF());
+    generator->setTailLines(options.getTailLines());
+    generator->setMemoryMapping(!options.noMemoryMapping());
+    generator->setFont(options.getFont());
+    generator->setFontSize(options.getFontSize());
+    generator->setStyleSheet(options.getStyleSheetPath());
+    generator->setPreformatting(ansifilter::WRAP_SIMPLE, options.getWrapLineLength());
+    generator->setShowLineNumbers(options.showLineNumbers());
+    generator->setWrapNoNumbers(!options.wrapNoNumbers());
+    generator->setAddAnchors(options.addAnchors(), options.addFunnyAnchors());
+    generator->setParseCodePage437(options.parseCP437());
+    generator->setParseAsciiBin(options.parseAsciiBin());
+    generator->setParseAsciiTundra(options.parseAsciiTundra());
+    generator->setIgnoreClearSeq(options.ignoreClearSeq());
+    generator->setIgnoreCSISeq(options.ignoreCSISeq());
+
+    generator->setApplyDynStyles(options.applyDynStyles());
+
+    generator->setAsciiArtSize(options.getAsciiArtWidth(), options.getAsciiArtHeight());
+    generator->setOmitTrailingCR(options.omitTrailingCR());
+    generator->setOmitVersionInfo(options.omitVersionInfo());
+
+    generator->setSVGSize ( options.getWidth(), options.getHeight() );
+
+    generator->setLineAppendage ( options.getLineAppendage() );
+    generator->setOutputBufferSize ( options.getOutputBufferSize() );
+    generator->setCollectStats ( options.printStats() );
+    return true;
+}
+
+string ANSIFilterApp::getOutFilePath(CmdLineOptions& options, const string& inFile, size_t fileCount)
+{
+    if (fileCount<=1) {
+        return options.getSingleOutFilename();
+    }
+    string::size_type pos=inFile.find_last_of(Platform::pathSeparator);
+    return options.getOutDirectory() + inFile.substr(pos+1) + options.getOutFileSuffix();
+}
+
+bool ANSIFilterApp::reportError(ansifilter::ParseError error, const string& inFile, const string& outFilePath)
+{
+    if (error==ansifilter::BAD_INPUT) {
+        std::cerr << "could not read input: " << inFile << "\n";
+        return true;
+    } else if (error==ansifilter::BAD_OUTPUT) {
+        std::cerr << "could not write output: " << outFilePath << "\n";
+        return true;
+    }
+    return false;
+}
+
+void ANSIFilterApp::printStats(const CmdLineOptions& options, const ansifilter::ConversionStats& stats, const string& inFile)
+{
+    std::cerr << (options.printStatsAsJSON() ? stats.toJSON(inFile) : stats.toText(inFile));
+}
+
+bool ANSIFilterApp::convertParallel(CmdLineOptions& options, const vector<string>& inFileList,
+                                    unsigned int jobs, ansifilter::DerivedStyleRegistry* styleRegistry)
+{
+    size_t fileCount=inFileList.size();
+    vector<off_t> fileSizes(fileCount);
+    vector<string> outFilePaths(fileCount);
+    vector<size_t> order(fileCount);
+    for (size_t i=0; i<fileCount; i++) {
+        fileSizes[i] = Platform::fileSize(inFileList[i]);
+        outFilePaths[i] = getOutFilePath(options, inFileList[i], fileCount);
+        order[i] = i;
+    }
+
+    // start with the largest files, so the run does not end with a single busy worker
+    std::stable_sort(order.begin(), order.end(),
+                     [&fileSizes](size_t a, size_t b) { return fileSizes[a] > fileSizes[b]; });
+
+    // each worker owns its generator, only the style registry is shared
+    vector<unique_ptr<ansifilter::CodeGenerator>> generators;
+    for (unsigned int j=0; j<jobs; j++) {
+        generators.emplace_back(ansifilter::CodeGenerator::getInstance(options.getOutputType()));
+        initGenerator(generators.back().get(), options);
+        generators.back()->setDerivedStyleRegistry(styleRegistry);
+    }
+
+    const off_t maxFileSize = options.getMaxFileSize();
+    const int FILE_TOO_LARGE = -1;
+    vector<int> results(fileCount, ansifilter::PARSE_OK);
+    vector<ansifilter::ConversionStats> stats(fileCount);
+    std::atomic<size_t> nextFile(0);
+
+    auto worker = [&](ansifilter::CodeGenerator* generator) {
+        size_t n;
+        while ((n=nextFile++) < fileCount) {
+            size_t i = order[n];
+            if (fileSizes[i] > maxFileSize) {
+                results[i] = FILE_TOO_LARGE;
+                continue;
+            }
+            generator->setTitle(options.getDocumentTitle().empty()?
+                                inFileList[i]:options.getDocumentTitle());
+            results[i] = generator->generateFile(inFileList[i], outFilePaths[i]);
+            stats[i] = generator->getStats();
+        }
+    };
+
+    vector<std::thread> workers;
+    for (unsigned int j=1; j<jobs; j++) {
+        workers.emplace_back(worker, generators[j].get());
+    }
+    worker(generators[0].get());
+    for (auto& t: workers) {
+        t.join();
+    }
+
+    // report errors in input order, independent of the scheduling
+    bool failure=false;
+    for (size_t i=0; i<fileCount; i++) {
+        if (results[i]==FILE_TOO_LARGE) {
+            std::cerr <<"file exceeds max size (see --max-size): " << inFileList[i] << "\n";
+            failure=true;
+        } else if (reportError((ansifilter::ParseError)results[i], inFileList[i], outFilePaths[i])) {
+            failure=true;
+        } else if (options.printStats()) {
+            printStats(options, stats[i], inFileList[i]);
+        }
+    }
+    return !failure;
+}
+
 int ANSIFilterApp::run( const int argc, const char *argv[] )
 {
 
@@ -139,78 +292,62 @@ int ANSIFilterApp::run( const int argc, const char *argv[] )
     string outDirectory = options.getOutDirectory();
 
     unsigned int fileCount=inFileList.size(), i=0;
-    string::size_type pos=0;
-    string inFileName, outFilePath;
+    string outFilePath;
     string mapPath = options.getMapPath();
     bool failure=false;
 
-    if (!options.omitDefaultForegroundColor()) {
-        generator->setDefaultForegroundColor();
-    }
-
-    if (!generator->setColorMap(mapPath)){
+    if (!initGenerator(generator.get(), options)){
         std::cerr <<"could not read map file: " << mapPath << "\n";
         return EXIT_FAILURE;
     }
 
-    while (i < fileCount && !failure) {
-
-        if (fileCount>1) {
-            pos=(inFileList[i]).find_last_of(Platform::pathSeparator);
-            inFileName = inFileList[i].substr(pos+1);
-            outFilePath = outDirectory;
-            outFilePath += inFileName;
-            outFilePath += options.getOutFileSuffix();
-        } else {
-            outFilePath = options.getSingleOutFilename();
-        }
+    unsigned int jobs = std::min(options.getJobs(), fileCount);
 
-        if ( inFileList[i].size() && Platform::fileSize(inFileList[i]) > options.getMaxFileSize() ) {
+    ansifilter::DerivedStyleRegistry styleRegistry;
 
-            std::cerr <<"file exceeds max size (see --max-size): " << inFileList[i] << "\n";
-            return EXIT_FAILURE;
+    // a single input file is split into chunks which are rendered in parallel
+    vector<unique_ptr<ansifilter::CodeGenerator>> chunkGenerators;
+    if (fileCount==1 && options.getJobs()>1) {
+        vector<ansifilter::CodeGenerator*> chunkWorkers;
+        generator->setDerivedStyleRegistry(&styleRegistry);
+        for (unsigned int j=0; j<options.getJobs(); j++) {
+            chunkGenerators.emplace_back(ansifilter::CodeGenerator::getInstance(options.getOutputType()));
+            initGenerator(chunkGenerators.back().get(), options);
+            chunkGenerators.back()->setDerivedStyleRegistry(&styleRegistry);
+            chunkWorkers.push_back(chunkGenerators.back().get());
         }
+        generator->setChunkWorkers(chunkWorkers, options.getChunkSize());
+    }
 
-        generator->setTitle(options.getDocumentTitle().empty()?
-                            inFileList[i]:options.getDocumentTitle());
-
-        generator->setEncoding(options.getEncoding());
-        generator->setFragmentCode(options.fragmentOutput());
-        generator->setPlainOutput(options.plainOutput());
-        generator->setContinueReading(options.ignoreInputEOF());
-        generator->setFont(options.getFont());
-        generator->setFontSize(options.getFontSize());
-        generator->setStyleSheet(options.getStyleSheetPath());
-        generator->setPreformatting(ansifilter::WRAP_SIMPLE, options.getWrapLineLength());
-        generator->setShowLineNumbers(options.showLineNumbers());
-        generator->setWrapNoNumbers(!options.wrapNoNumbers());
-        generator->setAddAnchors(options.addAnchors(), options.addFunnyAnchors());
-        generator->setParseCodePage437(options.parseCP437());
-        generator->setParseAsciiBin(options.parseAsciiBin());
-        generator->setParseAsciiTundra(options.parseAsciiTundra());
-        generator->setIgnoreClearSeq(options.ignoreClearSeq());
-        generator->setIgnoreCSISeq(options.ignoreCSISeq());
+    if (jobs>1) {
+        // parallel conversions register their styles in scheduling order
+        styleRegistry.setNumberedByKey(true);
+        generator->setDerivedStyleRegistry(&styleRegistry);
+        failure = !convertParallel(options, inFileList, jobs, &styleRegistry);
+    } else {
+        // like convertParallel, continue after a failed file and report all errors
+        for (i=0; i < fileCount; i++) {
 
-        generator->setApplyDynStyles(options.applyDynStyles());
+            outFilePath = getOutFilePath(options, inFileList[i], fileCount);
 
-        generator->setAsciiArtSize(options.getAsciiArtWidth(), options.getAsciiArtHeight());
-        generator->setOmitTrailingCR(options.omitTrailingCR());
-        generator->setOmitVersionInfo(options.omitVersionInfo());
+            if ( inFileList[i].size() && Platform::fileSize(inFileList[i]) > options.getMaxFileSize() ) {
 
-        generator->setSVGSize ( options.getWidth(), options.getHeight() );
+                std::cerr <<"file exceeds max size (see --max-size): " << inFileList[i] << "\n";
+                failure = true;
+                continue;
+            }
 
-        generator->setLineAppendage ( options.getLineAppendage() );
+            generator->setTitle(options.getDocumentTitle().empty()?
+                                inFileList[i]:options.getDocumentTitle());
 
-        ansifilter::ParseError error = generator->generateFile(inFileList[i], outFilePath);
+            ansifilter::ParseError error = generator->generateFile(inFileList[i], outFilePath);
 
-        if (error==ansifilter::BAD_INPUT) {
-            std::cerr << "could not read input: " << inFileList[i] << "\n";
-            failure=true;
-        } else if (error==ansifilter::BAD_OUTPUT) {
-            std::cerr << "could not write output: " << outFilePath << "\n";
-            failure=true;
+            if (reportError(error, inFileList[i], outFilePath)) {
+                failure = true;
+            } else if (options.printStats()) {
+                printStats(options, generator->getStats(), inFileList[i]);
+            }
         }
-        ++i;
     }
 
     if (options.applyDynStyles() && !failure) {
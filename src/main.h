@@ -29,6 +29,14 @@ along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "cmdlineoptions.h"
 #include "version.h"
+#include "enums.h"
+
+namespace ansifilter
+{
+class CodeGenerator;
+class DerivedStyleRegistry;
+struct ConversionStats;
+}
 
 /// Main application class of the command line interface
 
@@ -52,6 +60,35 @@ private:
     void printVersionInfo();
     void printHelp();
 
+    /** Apply the command line options to a generator
+      \param generator generator instance
+      \param options command line options
+      \return false if the colour map could not be read
+    */
+    bool initGenerator(ansifilter::CodeGenerator* generator, const CmdLineOptions& options);
+
+    /** \return output path of an input file */
+    string getOutFilePath(CmdLineOptions& options, const string& inFile, size_t fileCount);
+
+    /** Print error message of a conversion
+      \return true if an error occurred
+    */
+    bool reportError(ansifilter::ParseError error, const string& inFile, const string& outFilePath);
+
+    /** Print the statistics of a conversion to stderr (--stats) */
+    void printStats(const CmdLineOptions& options, const ansifilter::ConversionStats& stats, const string& inFile);
+
+    /** Convert input files in parallel, largest files first. Each worker
+        thread uses its own generator; errors are reported in input order.
+      \param options command line options
+      \param inFileList input files
+      \param jobs number of worker threads
+      \param styleRegistry derived style registry shared by the workers
+      \return true if all files were converted
+    */
+    bool convertParallel(CmdLineOptions& options, const vector<string>& inFileList,
+                         unsigned int jobs, ansifilter::DerivedStyleRegistry* styleRegistry);
+
 };
 
 #endif
@@ -0,0 +1,187 @@
+/***************************************************************************
+                          mappedfile.cpp -  description
+                             -------------------
+    copyright            : (C) 2024 by Andre Simon
+    email                : a.simon@mailbox.org
+ ***************************************************************************/
+
+/*
+This file is part of ANSIFilter.
+
+ANSIFilter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ANSIFilter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "mappedfile.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <mutex>
+#endif
+
+namespace ansifilter
+{
+
+#ifndef WIN32
+/// mappings which the SIGBUS handler may repair, free slots are null
+static std::atomic<MappedFile*> guardedFiles[64];
+
+static struct sigaction previousBusAction;
+
+/// set before the handler is installed, sysconf is not async-signal-safe
+static size_t guardPageSize;
+
+static void handleBusError(int, siginfo_t* info, void*)
+{
+    if (!MappedFile::recoverFault(info->si_addr)) {
+        // not caused by a mapped input file: the fault repeats with the
+        // previous action after returning
+        sigaction(SIGBUS, &previousBusAction, nullptr);
+    }
+}
+#endif
+
+MappedFile::MappedFile()
+    : data(nullptr),
+      size(0),
+      released(0),
+      truncated(false)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+bool MappedFile::map(const std::string& fileName)
+{
+    unmap();
+#ifdef WIN32
+    (void)fileName;
+    return false;
+#else
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+
+    madvise(addr, st.st_size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(addr);
+    size = st.st_size;
+    if (!guard()) {
+        // without protection against truncation the file is read as stream
+        unmap();
+        return false;
+    }
+    return true;
+#endif
+}
+
+bool MappedFile::guard()
+{
+#ifndef WIN32
+    static std::once_flag installed;
+    std::call_once(installed, []() {
+        guardPageSize = sysconf(_SC_PAGESIZE);
+        struct sigaction action = {};
+        action.sa_sigaction = handleBusError;
+        action.sa_flags = SA_SIGINFO;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGBUS, &action, &previousBusAction);
+    });
+
+    for (auto& slot : guardedFiles) {
+        MappedFile* expected = nullptr;
+        if (slot.compare_exchange_strong(expected, this)) {
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+bool MappedFile::recoverFault(const void* addr)
+{
+#ifndef WIN32
+    const char* p = static_cast<const char*>(addr);
+    for (auto& slot : guardedFiles) {
+        MappedFile* file = slot.load();
+        if (!file || p < file->data || p >= file->data + file->size) {
+            continue;
+        }
+        size_t begin = (p - file->data) - (p - file->data) % guardPageSize;
+        void* zeros = mmap(const_cast<char*>(file->data) + begin, file->size - begin, PROT_READ,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+        if (zeros == MAP_FAILED) {
+            return false;
+        }
+        file->truncated.store(true);
+        return true;
+    }
+#else
+    (void)addr;
+#endif
+    return false;
+}
+
+void MappedFile::unmap()
+{
+#ifndef WIN32
+    if (data) {
+        for (auto& slot : guardedFiles) {
+            MappedFile* expected = this;
+            slot.compare_exchange_strong(expected, nullptr);
+        }
+        munmap(const_cast<char*>(data), size);
+    }
+#endif
+    data = nullptr;
+    size = 0;
+    released = 0;
+    truncated.store(false);
+}
+
+void MappedFile::release(size_t offset)
+{
+#ifndef WIN32
+    if (!data || offset < released + releaseStep) {
+        return;
+    }
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t end = offset - offset % pageSize;
+    madvise(const_cast<char*>(data) + released, end - released, MADV_DONTNEED);
+    released = end;
+#else
+    (void)offset;
+#endif
+}
+
+}
@@ -0,0 +1,114 @@
+/***************************************************************************
+                          mappedfile.h  -  description
+                             -------------------
+    copyright            : (C) 2024 by Andre Simon
+    email                : a.simon@mailbox.org
+ ***************************************************************************/
+
+/*
+This file is part of ANSIFilter.
+
+ANSIFilter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ANSIFilter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <atomic>
+#include <string>
+
+namespace ansifilter
+{
+
+/** \brief Maps a regular file into memory for reading.
+
+    The kernel is advised that the file will be read sequentially. Mapping
+    fails for files which are not regular files (pipes, devices), for empty
+    files and on platforms without mmap(); the caller should read the file
+    as stream in this case.
+
+    If the file is truncated while it is mapped (e.g. by logrotate with
+    copytruncate), reading the lost pages raises SIGBUS. A signal handler
+    replaces these pages with zeros and marks the file as truncated, so
+    the caller can stop and report a read error instead of crashing.
+
+* @author Andre Simon
+*/
+
+class MappedFile
+{
+public:
+
+    MappedFile();
+
+    ~MappedFile();
+
+    /** Map a file, unmapping the previous one
+        \param fileName file path
+        \return true if the file was mapped */
+    bool map(const std::string& fileName);
+
+    /** Remove the mapping */
+    void unmap();
+
+    /** Tell the kernel that the mapped data before offset is no longer
+        needed, so the resident size does not grow with the file size.
+        The pages are released in steps of releaseStep bytes.
+        \param offset end of the processed data */
+    void release(size_t offset);
+
+    /** \return mapped bytes, nullptr if no file is mapped */
+    const char* getData() const
+    {
+        return data;
+    }
+
+    /** \return number of mapped bytes */
+    size_t getSize() const
+    {
+        return size;
+    }
+
+    /** \return true if the file was truncated after it was mapped; the
+                 data beyond the new end of file reads as zeros */
+    bool isTruncated() const
+    {
+        return truncated.load(std::memory_order_relaxed);
+    }
+
+    /** Called by the SIGBUS handler: replaces the pages of a truncated
+        mapping from addr to its end with zero pages. Only atomics and mmap
+        are used, which are async-signal-safe.
+        \param addr faulting address
+        \return true if addr belongs to a mapped file and was replaced */
+    static bool recoverFault(const void* addr);
+
+private:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// minimum size of released data
+    static const size_t releaseStep = 16*1024*1024;
+
+    /** \return true if the mapping is registered for the SIGBUS handler */
+    bool guard();
+
+    const char* data;
+    size_t size;
+    size_t released;      ///< offset of data which is still needed
+    std::atomic<bool> truncated;
+};
+
+}
+
+#endif
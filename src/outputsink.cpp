@@ -0,0 +1,211 @@
+/***************************************************************************
+                          outputsink.cpp -  description
+                             -------------------
+    copyright            : (C) 2024 by Andre Simon
+    email                : a.simon@mailbox.org
+ ***************************************************************************/
+
+/*
+This file is part of ANSIFilter.
+
+ANSIFilter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ANSIFilter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "outputsink.h"
+#include "probes.h"
+
+#include <cerrno>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+namespace ansifilter
+{
+
+OutputSink::OutputSink(size_t bufferSize):
+    failed(false),
+    buffer(bufferSize),
+    used(0),
+    bytesWritten(0),
+    writeTime(nullptr)
+{
+}
+
+void OutputSink::flush()
+{
+    PhaseTimer timer(writeTime);
+    if (used) {
+        AF_PROBE1(output_flush, used);
+        if (!failed && !writeData(buffer.data(), used)) {
+            failed = true;
+        }
+        bytesWritten += used;
+        used = 0;
+    }
+    if (!failed) sync();
+}
+
+void OutputSink::setBufferSize(size_t bufferSize)
+{
+    flush();
+    buffer.resize(bufferSize);
+    buffer.shrink_to_fit();
+}
+
+void OutputSink::writeLarge(const char* s, size_t n)
+{
+    PhaseTimer timer(writeTime);
+    if (n < buffer.size()) {
+        AF_PROBE1(output_flush, used);
+        if (!failed && !writeData(buffer.data(), used)) {
+            failed = true;
+        }
+        bytesWritten += used;
+        memcpy(buffer.data(), s, n);
+        used = n;
+        return;
+    }
+    // blocks larger than the buffer are written together with the buffer content
+    AF_PROBE1(output_flush, used + n);
+    if (!failed && !writeData(buffer.data(), used, s, n)) {
+        failed = true;
+    }
+    bytesWritten += used + n;
+    used = 0;
+}
+
+bool OutputSink::writeData(const char* s1, size_t n1, const char* s2, size_t n2)
+{
+    return (!n1 || writeData(s1, n1)) && (!n2 || writeData(s2, n2));
+}
+
+FdOutputSink::FdOutputSink(int fd, bool closeFd, size_t bufferSize):
+    OutputSink(bufferSize),
+    fd(fd),
+    closeFd(closeFd)
+{
+}
+
+FdOutputSink::~FdOutputSink()
+{
+    flush();
+    if (closeFd) {
+        close(fd);
+    }
+}
+
+bool FdOutputSink::writeData(const char* s, size_t n)
+{
+    while (n) {
+        auto written = ::write(fd, s, n);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        s += written;
+        n -= written;
+    }
+    return true;
+}
+
+bool FdOutputSink::writeData(const char* s1, size_t n1, const char* s2, size_t n2)
+{
+#ifdef WIN32
+    return OutputSink::writeData(s1, n1, s2, n2);
+#else
+    while (n1) {
+        struct iovec iov[2] = { { const_cast<char*>(s1), n1 }, { const_cast<char*>(s2), n2 } };
+        ssize_t written = writev(fd, iov, 2);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if ((size_t)written < n1) {
+            s1 += written;
+            n1 -= written;
+        } else {
+            s2 += written-n1;
+            n2 -= written-n1;
+            n1 = 0;
+        }
+    }
+    return writeData(s2, n2);
+#endif
+}
+
+StringOutputSink::StringOutputSink(std::string& target, size_t bufferSize):
+    OutputSink(bufferSize),
+    target(target)
+{
+}
+
+StringOutputSink::~StringOutputSink()
+{
+    flush();
+}
+
+bool StringOutputSink::writeData(const char* s, size_t n)
+{
+    target.append(s, n);
+    return true;
+}
+
+CallbackOutputSink::CallbackOutputSink(Callback callback, size_t bufferSize):
+    OutputSink(bufferSize),
+    callback(std::move(callback))
+{
+}
+
+CallbackOutputSink::~CallbackOutputSink()
+{
+    flush();
+}
+
+bool CallbackOutputSink::writeData(const char* s, size_t n)
+{
+    callback(std::string_view(s, n));
+    return true;
+}
+
+StreamOutputSink::StreamOutputSink(std::ostream* stream, bool ownStream, size_t bufferSize):
+    OutputSink(bufferSize),
+    stream(stream),
+    ownStream(ownStream)
+{
+}
+
+StreamOutputSink::~StreamOutputSink()
+{
+    flush();
+    if (ownStream) {
+        delete stream;
+    }
+}
+
+bool StreamOutputSink::writeData(const char* s, size_t n)
+{
+    stream->write(s, n);
+    return !stream->fail();
+}
+
+void StreamOutputSink::sync()
+{
+    stream->flush();
+    if (stream->fail()) failed = true;
+}
+
+}
@@ -0,0 +1,269 @@
+/***************************************************************************
+                          outputsink.h  -  description
+                             -------------------
+    copyright            : (C) 2024 by Andre Simon
+    email                : a.simon@mailbox.org
+ ***************************************************************************/
+
+/*
+This file is part of ANSIFilter.
+
+ANSIFilter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ANSIFilter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef OUTPUTSINK_H
+#define OUTPUTSINK_H
+
+#include <cstring>
+#include <charconv>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "conversionstats.h"
+
+namespace ansifilter
+{
+
+/** \brief Buffered destination of the generated output.
+
+    Output is collected in a buffer and passed to the destination in large
+    blocks. Subclasses implement writeData() to write to a file descriptor,
+    a string, a callback function or an ostream.
+
+* @author Andre Simon
+*/
+
+class OutputSink
+{
+public:
+
+    /// default size of the output buffer
+    static const size_t defaultBufferSize = 256*1024;
+
+    /** \param bufferSize size of the output buffer, 0 disables buffering */
+    explicit OutputSink(size_t bufferSize=defaultBufferSize);
+
+    virtual ~OutputSink() = default;
+
+    /** Append bytes to the output
+        \param s bytes
+        \param n number of bytes */
+    void write(const char* s, size_t n)
+    {
+        if (n <= buffer.size()-used) {
+            memcpy(buffer.data()+used, s, n);
+            used+=n;
+        } else {
+            writeLarge(s, n);
+        }
+    }
+
+    OutputSink& operator<<(std::string_view s)
+    {
+        write(s.data(), s.size());
+        return *this;
+    }
+
+    OutputSink& operator<<(char c)
+    {
+        write(&c, 1);
+        return *this;
+    }
+
+    /** Append the decimal representation of an integer */
+    template <typename T, typename std::enable_if<std::is_integral<T>::value
+                                                  && !std::is_same<T, char>::value, int>::type = 0>
+    OutputSink& operator<<(T value)
+    {
+        char digits[24];
+        auto result = std::to_chars(digits, digits+sizeof(digits), value);
+        write(digits, result.ptr-digits);
+        return *this;
+    }
+
+    /** Pass buffered output to the destination */
+    void flush();
+
+    /** Drop the buffered output without passing it to the destination */
+    void discard()
+    {
+        used = 0;
+    }
+
+    /** Flush the output and resize the buffer
+        \param bufferSize new buffer size, 0 disables buffering */
+    void setBufferSize(size_t bufferSize);
+
+    /** \return size of the output buffer */
+    size_t getBufferSize() const
+    {
+        return buffer.size();
+    }
+
+    /** \return number of bytes passed to the destination */
+    uint64_t getBytesWritten() const
+    {
+        return bytesWritten;
+    }
+
+    /** Measure the time spent writing to the destination
+        \param t receives the write times, nullptr to stop measuring */
+    void setWriteTimer(PhaseTime* t)
+    {
+        writeTime = t;
+    }
+
+    /** \return true if the destination reported an error */
+    bool fail() const
+    {
+        return failed;
+    }
+
+protected:
+
+    /** Write a block of data to the destination
+        \param s bytes
+        \param n number of bytes
+        \return false if an error occurred */
+    virtual bool writeData(const char* s, size_t n) = 0;
+
+    /** Write two blocks of data to the destination; the default
+        implementation calls writeData() twice
+        \return false if an error occurred */
+    virtual bool writeData(const char* s1, size_t n1, const char* s2, size_t n2);
+
+    /** Flush the destination after the buffer was written */
+    virtual void sync() {}
+
+    bool failed;
+
+private:
+
+    /** handle data which does not fit into the remaining buffer space */
+    void writeLarge(const char* s, size_t n);
+
+    std::vector<char> buffer;
+    size_t used;          ///< number of buffered bytes
+    uint64_t bytesWritten;
+    PhaseTime* writeTime;
+};
+
+/** \brief Writes output to a file descriptor using write() and writev(). */
+
+class FdOutputSink : public OutputSink
+{
+public:
+
+    /** \param fd file descriptor
+        \param closeFd close the descriptor in the destructor
+        \param bufferSize size of the output buffer */
+    FdOutputSink(int fd, bool closeFd, size_t bufferSize=defaultBufferSize);
+
+    ~FdOutputSink() override;
+
+protected:
+    bool writeData(const char* s, size_t n) override;
+    bool writeData(const char* s1, size_t n1, const char* s2, size_t n2) override;
+
+private:
+    int fd;
+    bool closeFd;
+};
+
+/** \brief Appends output to a string. */
+
+class StringOutputSink : public OutputSink
+{
+public:
+
+    /** \param target string which receives the output; it must exist as long as the sink
+        \param bufferSize size of the output buffer */
+    explicit StringOutputSink(std::string& target, size_t bufferSize=0);
+
+    ~StringOutputSink() override;
+
+protected:
+    bool writeData(const char* s, size_t n) override;
+
+private:
+    std::string& target;
+};
+
+/** \brief Passes blocks of output to a callback function. */
+
+class CallbackOutputSink : public OutputSink
+{
+public:
+
+    typedef std::function<void(std::string_view)> Callback;
+
+    /** \param callback function which receives the output blocks
+        \param bufferSize size of the output buffer */
+    explicit CallbackOutputSink(Callback callback, size_t bufferSize=defaultBufferSize);
+
+    ~CallbackOutputSink() override;
+
+protected:
+    bool writeData(const char* s, size_t n) override;
+
+private:
+    Callback callback;
+};
+
+/** \brief Discards all output. */
+
+class NullOutputSink : public OutputSink
+{
+public:
+
+    NullOutputSink():
+        OutputSink(0)
+    {
+    }
+
+protected:
+    bool writeData(const char*, size_t) override
+    {
+        return true;
+    }
+};
+
+/** \brief Writes output to an ostream. */
+
+class StreamOutputSink : public OutputSink
+{
+public:
+
+    /** \param stream output stream
+        \param ownStream delete the stream in the destructor
+        \param bufferSize size of the output buffer */
+    StreamOutputSink(std::ostream* stream, bool ownStream, size_t bufferSize=defaultBufferSize);
+
+    ~StreamOutputSink() override;
+
+protected:
+    bool writeData(const char* s, size_t n) override;
+    void sync() override;
+
+private:
+    std::ostream* stream;
+    bool ownStream;
+};
+
+}
+
+#endif
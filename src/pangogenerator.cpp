@@ -33,6 +33,18 @@ along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
 namespace ansifilter
 {
 
+/// replacement strings of Pango markup special characters
+static constexpr EscapeTable makePangoEscapeTable()
+{
+    EscapeTable table = makeEscapeTable();
+    table['<'] = "&lt;";
+    table['>'] = "&gt;";
+    table['&'] = "&amp;";
+    return table;
+}
+
+static constexpr EscapeTable pangoEscapeTable = makePangoEscapeTable();
+
 PangoGenerator::PangoGenerator ():
     CodeGenerator(PANGO),
     fileSuffix(".pango")
@@ -41,6 +53,7 @@ PangoGenerator::PangoGenerator ():
     styleCommentOpen="";
     styleCommentClose="";
     spacer=" ";
+    escapeTable = &pangoEscapeTable;
 }
 
 string PangoGenerator::getOpenTag()
@@ -112,28 +125,4 @@ void PangoGenerator::printBody()
     processInput();
 }
 
-string PangoGenerator::maskCharacter(unsigned char c)
-{
-    switch (c) {
-    case '<' :
-        return "&lt;";
-        break;
-    case '>' :
-        return "&gt;";
-        break;
-    case '&' :
-        return "&amp;";
-        break;
-    case '\t':
-        return "\t";
-        break;
-
-    default :
-        if (c>0x1f ) { // printable?
-            return string( 1, c );;
-        } else {
-            return "";
-        }
-    }
-}
 }
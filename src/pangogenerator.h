@@ -70,9 +70,6 @@ private:
 
     /** Print document footer*/
     string getFooter();
-
-    /** \return escaped character*/
-    virtual string maskCharacter(unsigned char );
 };
 
 }
@@ -55,13 +55,4 @@ void PlaintextGenerator::printBody()
     processInput();
 }
 
-string PlaintextGenerator::maskCharacter(unsigned char c)
-{
-    if (c>0x1f || c=='\t') {
-        return string( 1, c );;
-    } else {
-        return "";
-    }
-}
-
 }
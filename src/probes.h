@@ -0,0 +1,63 @@
+/***************************************************************************
+                          probes.h  -  description
+                             -------------------
+    copyright            : (C) 2024 by Andre Simon
+    email                : a.simon@mailbox.org
+ ***************************************************************************/
+
+/*
+This file is part of ANSIFilter.
+
+ANSIFilter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ANSIFilter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PROBES_H
+#define PROBES_H
+
+/* Static tracepoints (USDT) for bpftrace and perf, provider "ansifilter".
+   They are compiled in with -DANSIFILTER_USDT (make USDT=1, cmake
+   -DANSIFILTER_USDT=ON), which requires sys/sdt.h of systemtap. A probe
+   which is not attached is a single nop instruction.
+
+   file_open(const char* path, int64_t size)   input file opened, size -1 if unknown
+   file_close(const char* path, uint64_t bytesIn, uint64_t bytesOut)
+   lines(uint64_t lineNumber)                  every AF_PROBE_LINE_INTERVAL input lines
+   sgr_parse(const char* params, size_t length)
+   style_change(uint32_t fgRGB, uint32_t bgRGB) a new style is opened
+   output_flush(size_t bytes)                  output buffer passed to the destination
+   tail_wakeup(int reopened)                   --tail found new data, 1 after rotation
+
+   Example: bpftrace -e 'usdt:./ansifilter:ansifilter:output_flush { @ = hist(arg0); }' */
+
+#ifdef ANSIFILTER_USDT
+
+#include <sys/sdt.h>
+
+#define AF_PROBE1(name, a)       DTRACE_PROBE1(ansifilter, name, a)
+#define AF_PROBE2(name, a, b)    DTRACE_PROBE2(ansifilter, name, a, b)
+#define AF_PROBE3(name, a, b, c) DTRACE_PROBE3(ansifilter, name, a, b, c)
+
+#else
+
+#define AF_PROBE1(name, a)       do { } while (0)
+#define AF_PROBE2(name, a, b)    do { } while (0)
+#define AF_PROBE3(name, a, b, c) do { } while (0)
+
+#endif
+
+/// number of input lines between two lines probes
+#ifndef AF_PROBE_LINE_INTERVAL
+#define AF_PROBE_LINE_INTERVAL 10000
+#endif
+
+#endif
@@ -15,7 +15,7 @@ FORMS += ansifilter.ui
 SOURCES += main.cpp mydialog.cpp
 SOURCES += ../elementstyle.cpp ../plaintextgenerator.cpp ../codegenerator.cpp
 SOURCES += ../platform_fs.cpp ../rtfgenerator.cpp ../htmlgenerator.cpp ../pangogenerator.cpp ../texgenerator.cpp ../latexgenerator.cpp ../bbcodegenerator.cpp ../svggenerator.cpp
-SOURCES += ../stringtools.cpp ../stylecolour.cpp ../preformatter.cpp
+SOURCES += ../stringtools.cpp ../stylecolour.cpp ../preformatter.cpp ../linereader.cpp ../bytescanner.cpp ../outputsink.cpp ../mappedfile.cpp ../filefollower.cpp ../conversionstats.cpp
 
 RESOURCES += ansifilter.qrc
 win32 {
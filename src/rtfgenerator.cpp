@@ -34,6 +34,50 @@ along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
 namespace ansifilter
 {
 
+/// replacement strings of RTF special characters
+static constexpr EscapeTable makeRtfEscapeTable()
+{
+    EscapeTable table = makeEscapeTable();
+    table['{'] = "\\{";
+    table['}'] = "\\}";
+    table['\\'] = "\\\\";
+    table['0'] = "{0}";
+    table['1'] = "{1}";
+    table['2'] = "{2}";
+    table['3'] = "{3}";
+    table['4'] = "{4}";
+    table['5'] = "{5}";
+    table['6'] = "{6}";
+    table['7'] = "{7}";
+    table['8'] = "{8}";
+    table['9'] = "{9}";
+    table[AUML_LC] = "\\'e4";
+    table[OUML_LC] = "\\'f6";
+    table[UUML_LC] = "\\'fc";
+    table[AUML_UC] = "\\'c4";
+    table[OUML_UC] = "\\'d6";
+    table[UUML_UC] = "\\'dc";
+    table[AACUTE_LC] = "\\'e1";
+    table[EACUTE_LC] = "\\'e9";
+    table[OACUTE_LC] = "\\'f3";
+    table[UACUTE_LC] = "\\'fa";
+    table[AGRAVE_LC] = "\\'e0";
+    table[EGRAVE_LC] = "\\'e8";
+    table[OGRAVE_LC] = "\\'f2";
+    table[UGRAVE_LC] = "\\'f9";
+    table[AACUTE_UC] = "\\'c1";
+    table[EACUTE_UC] = "\\'c9";
+    table[OACUTE_UC] = "\\'d3";
+    table[UACUTE_UC] = "\\'da";
+    table[AGRAVE_UC] = "\\'c0";
+    table[EGRAVE_UC] = "\\'c8";
+    table[OGRAVE_UC] = "\\'d2";
+    table[UGRAVE_UC] = "\\'d9";
+    table[SZLIG] = "\\'df";
+    return table;
+}
+
+static constexpr EscapeTable rtfEscapeTable = makeRtfEscapeTable();
 
 RtfGenerator::RtfGenerator()
 : CodeGenerator(RTF),
@@ -44,6 +88,7 @@ RtfGenerator::RtfGenerator()
 {
     newLineTag = "\\line\n";
     spacer=" ";
+    escapeTable = &rtfEscapeTable;
 
     // Page dimensions
     psMap["a3"] = PageSize(16837,23811);
@@ -111,6 +156,13 @@ string RtfGenerator::getHeader()
 }
 
 void RtfGenerator::printBody()
+{
+    printBodyBegin();
+    processInput();
+    printBodyEnd();
+}
+
+void RtfGenerator::printBodyBegin()
 {
     isUtf8 = encoding == "utf-8" || encoding == "UTF-8"; // FIXME
 
@@ -128,7 +180,7 @@ void RtfGenerator::printBody()
          << "{\\colortbl;";
 
     for (auto & i : workingPalette){
-      *out << getAttributes(StyleColour(rgb2html(i)));
+      *out << getAttributes(StyleColour(i));
     }
 
     *out << "}\n";
@@ -144,12 +196,13 @@ void RtfGenerator::printBody()
 
     //TODO save 24bit colors in RTF
     if (parseCP437/*||parseAsciiBin||parseAsciiTundra*/) *out << "\\cbpat1{";
+}
 
-    processInput();
-
+void RtfGenerator::printBodyEnd()
+{
     if (parseCP437/*||parseAsciiBin||parseAsciiTundra*/) *out << "}";
 
-    *out << "}"<<std::endl;
+    *out << "}\n";
 }
 
 string RtfGenerator::getFooter()
@@ -199,119 +252,19 @@ string RtfGenerator::maskCharacter(unsigned char c)
     }
   }
 
-  switch (c) {
-    case '}' :
-    case '{' :
-    case '\\' : {
-        string m;
-        m="\\";
-        return m+=c;
-    }
-    break;
-    case '\t' : // see deletion of nonprintable chars below
-        return "\t";
-        break;
-
-    case '0':
-    case '1':
-    case '2':
-    case '3':
-    case '4':
-    case '5':
-    case '6':
-    case '7':
-    case '8':
-    case '9': {
-        string m;
-        m="{";
-        m+=c;
-        m+="}";
-        return m;
+  return CodeGenerator::maskCharacter(c);
+}
+
+void RtfGenerator::appendEscaped(const char* begin, const char* end, LineBuffer& buffer)
+{
+    if (!isUtf8) {
+        CodeGenerator::appendEscaped(begin, end, buffer);
+        return;
     }
-    break;
-
-    case AUML_LC:
-        return "\\'e4";
-        break;
-    case OUML_LC:
-        return "\\'f6";
-        break;
-    case UUML_LC:
-        return "\\'fc";
-        break;
-    case AUML_UC:
-        return "\\'c4";
-        break;
-    case OUML_UC:
-        return "\\'d6";
-        break;
-    case UUML_UC:
-        return "\\'dc";
-        break;
-
-    case AACUTE_LC:
-        return "\\'e1";
-        break;
-    case EACUTE_LC:
-        return "\\'e9";
-        break;
-    case OACUTE_LC:
-        return "\\'f3";
-        break;
-    case UACUTE_LC:
-        return "\\'fa";
-        break;
-
-    case AGRAVE_LC:
-        return "\\'e0";
-        break;
-    case EGRAVE_LC:
-        return "\\'e8";
-        break;
-    case OGRAVE_LC:
-        return "\\'f2";
-        break;
-    case UGRAVE_LC:
-        return "\\'f9";
-        break;
-
-    case AACUTE_UC:
-        return "\\'c1";
-        break;
-    case EACUTE_UC:
-        return "\\'c9";
-        break;
-    case OACUTE_UC:
-        return "\\'d3";
-        break;
-    case UACUTE_UC:
-        return "\\'da";
-        break;
-    case AGRAVE_UC:
-        return "\\'c0";
-        break;
-    case EGRAVE_UC:
-        return "\\'c8";
-        break;
-    case OGRAVE_UC:
-        return "\\'d2";
-        break;
-    case UGRAVE_UC:
-        return "\\'d9";
-        break;
-
-    case SZLIG:
-        return "\\'df";
-        break;
-
-    default : {
-        if (c>0x1f ) {
-            return string( 1, c );
-        } else {
-            return "";
-        }
+    // UTF-8 sequences are converted to RTF unicode characters one by one
+    for (const char* c = begin; c<end; c++) {
+        buffer << maskCharacter(*c);
     }
-  }
 }
 
 string RtfGenerator::unicodeFromHTML(const string &htmlEntity){
@@ -424,16 +377,8 @@ void RtfGenerator::setPageSize(const string & ps)
 
 void RtfGenerator::insertLineNumber ()
 {
-    if ( showLineNumbers && !parseCP437 ) {
-
-        ostringstream lnum;
-        lnum << setw ( 5 ) << right;
-        if( numberCurrentLine ) {
-            lnum << lineNumber;
-            *out <<lnum.str()<<spacer;
-        } else {
-            *out << lnum.str(); //for indentation
-        }
+    if ( showLineNumbers && !parseCP437 && numberCurrentLine ) {
+        *out <<formatLineNumber()<<spacer;
     }
 }
 
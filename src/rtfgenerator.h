@@ -89,6 +89,12 @@ private:
     /** Prints document body*/
     void printBody();
 
+    /** Prints the RTF document group with font and colour tables */
+    void printBodyBegin();
+
+    /** Closes the RTF document group */
+    void printBodyEnd();
+
     /** Map of several pagesizes */
     PagesizeMap psMap;
 
@@ -107,6 +113,9 @@ private:
     /** \return escaped character*/
     virtual string maskCharacter(unsigned char );
 
+    /** Append text; UTF-8 input is masked character by character */
+    virtual void appendEscaped(const char* begin, const char* end, LineBuffer& buffer);
+
     /** \return escaped character*/
     virtual string maskCP437Character(unsigned char );
 
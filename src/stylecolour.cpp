@@ -30,24 +30,22 @@ along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
 #include <iostream>
 #include <sstream>
 #include <cmath>
+#include <array>
 
 
 namespace ansifilter
 {
 
 StyleColour::StyleColour(std::string_view red, std::string_view green, std::string_view blue)
+    : rgb(0)
 {
     ostringstream rgbStream;
     rgbStream << red << " " << green << " " << blue;
     setRGB(rgbStream.str());
 }
 
-StyleColour::StyleColour()
-{
-    rgb.iRed = rgb.iGreen = rgb.iBlue = 0;
-}
-
 StyleColour::StyleColour(std::string_view styleColourString)
+    : rgb(0)
 {
     setRGB(styleColourString);
 }
@@ -76,70 +74,77 @@ void StyleColour::setRGB(std::string_view styleColourString)
         valueStream >> b;
     }
 
-    StringTools::str2num<int>(rgb.iRed,   r, std::hex);
-    StringTools::str2num<int>(rgb.iGreen, g, std::hex);
-    StringTools::str2num<int>(rgb.iBlue,  b, std::hex);
+    int red=getRedValue(), green=getGreenValue(), blue=getBlueValue();
+    StringTools::str2num<int>(red,   r, std::hex);
+    StringTools::str2num<int>(green, g, std::hex);
+    StringTools::str2num<int>(blue,  b, std::hex);
+    *this = StyleColour(red, green, blue);
 }
 
 void StyleColour::setRed(std::string_view red)
 {
-    StringTools::str2num<int>(rgb.iRed, red, std::hex);
+    int value=getRedValue();
+    StringTools::str2num<int>(value, red, std::hex);
+    rgb = (rgb & 0x00ffff) | (uint32_t)(value & 0xff)<<16;
 }
 
 void StyleColour::setGreen(std::string_view green)
 {
-    StringTools::str2num<int>(rgb.iGreen, green, std::hex);
+    int value=getGreenValue();
+    StringTools::str2num<int>(value, green, std::hex);
+    rgb = (rgb & 0xff00ff) | (uint32_t)(value & 0xff)<<8;
 }
 
 void StyleColour::setBlue(std::string_view blue)
 {
-    StringTools::str2num<int>(rgb.iBlue, blue, std::hex);
+    int value=getBlueValue();
+    StringTools::str2num<int>(value, blue, std::hex);
+    rgb = (rgb & 0xffff00) | (uint32_t)(value & 0xff);
 }
 
-const string StyleColour::getRed(OutputType type) const
+const string& StyleColour::getRed(OutputType type) const
 {
-    switch (type) {
-    case RTF:
-        return int2str(rgb.iRed, std::dec);
-    case LATEX:
-        return float2str( (float) rgb.iRed / 255);
-    case TEX:
-        return float2str( 1 - (float) rgb.iRed / 255);
-    default:
-        return int2str(rgb.iRed, std::hex);
-    }
+    return formatComponent(getRedValue(), type);
 }
 
-const string StyleColour::getGreen(OutputType type) const
+const string& StyleColour::getGreen(OutputType type) const
 {
-    switch (type) {
-    case RTF:
-        return int2str(rgb.iGreen, std::dec);
-    case LATEX:
-        return float2str( (float) rgb.iGreen / 255);
-    case TEX:
-        return float2str( 1 - (float) rgb.iGreen / 255);
-    default:
-        return int2str(rgb.iGreen, std::hex);
-    }
+    return formatComponent(getGreenValue(), type);
 }
 
-const string StyleColour::getBlue(OutputType type) const
+const string& StyleColour::getBlue(OutputType type) const
 {
+    return formatComponent(getBlueValue(), type);
+}
+
+const string& StyleColour::formatComponent(int value, OutputType type)
+{
+    // a formatted component only depends on its value, so one table per notation
+    // covers the palette, the xterm colours and true colour values
+    static const std::array<std::array<string, 256>, 4> components = [] {
+        std::array<std::array<string, 256>, 4> c;
+        for (int i=0; i<256; i++) {
+            c[0][i] = int2str(i, std::hex);
+            c[1][i] = int2str(i, std::dec);
+            c[2][i] = float2str( (float) i / 255);
+            c[3][i] = float2str( 1 - (float) i / 255);
+        }
+        return c;
+    }();
+
     switch (type) {
     case RTF:
-        return int2str(rgb.iBlue, std::dec);
+        return components[1][value];
     case LATEX:
-        return float2str( (float) rgb.iBlue / 255);
+        return components[2][value];
     case TEX:
-        return float2str( 1 - (float) rgb.iBlue / 255);
+        return components[3][value];
     default:
-        return int2str(rgb.iBlue, std::hex);
+        return components[0][value];
     }
 }
 
-
-string StyleColour::int2str(const int num, std::ios_base& (*f)(std::ios_base&)) const
+string StyleColour::int2str(const int num, std::ios_base& (*f)(std::ios_base&))
 {
     std::ostringstream outStream;
     outStream.width(2);
@@ -149,7 +154,7 @@ string StyleColour::int2str(const int num, std::ios_base& (*f)(std::ios_base&))
     return outStream.str();
 }
 
-string StyleColour::float2str(const double num) const
+string StyleColour::float2str(const double num)
 {
     std::ostringstream outStream;
     outStream << ( floor ( num * 100 + .5 ) / 100);
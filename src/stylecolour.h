@@ -28,6 +28,7 @@ along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "enums.h"
 
+#include <cstdint>
 #include <string>
 #include <string_view>
 
@@ -42,12 +43,6 @@ namespace ansifilter
 * @author Andre Simon
  */
 
-struct RGBVal {
-    int iRed,    ///< Red value
-        iGreen,  ///< Green value
-        iBlue;   ///< Blue value
-};
-
 class StyleColour
 {
 public:
@@ -63,8 +58,25 @@ public:
     */
     StyleColour(std::string_view styleColourString);
 
-    StyleColour();
-    ~StyleColour() {};
+    /** Constructor
+        \param red Red value
+        \param green Green value
+        \param blue Blue value
+    */
+    constexpr StyleColour(unsigned char red, unsigned char green, unsigned char blue)
+        : rgb( (uint32_t)red<<16 | (uint32_t)green<<8 | blue )
+    {
+    }
+
+    /** Constructor
+        \param rgbValues array of red, green and blue values
+    */
+    explicit constexpr StyleColour(const unsigned char* rgbValues)
+        : StyleColour(rgbValues[0], rgbValues[1], rgbValues[2])
+    {
+    }
+
+    constexpr StyleColour() : rgb(0) {}
 
     /** Sets red, green and blue values
       \param styleColourString String containing colour attributes
@@ -85,20 +97,60 @@ public:
 
     /**  @param type Output type
          @return Red value in color representation according to output type */
-    const string getRed(OutputType type) const;
+    const string& getRed(OutputType type) const;
 
     /**  @param type Output type
          @return Green value in color representation according to output type */
 
-    const string getGreen(OutputType type) const;
+    const string& getGreen(OutputType type) const;
     /**  @param type Output type
          @return Blue value in color representation according to output type */
-    const string getBlue(OutputType type) const;
+    const string& getBlue(OutputType type) const;
+
+    /** @return colour as 0xRRGGBB */
+    uint32_t getRGB() const
+    {
+        return rgb;
+    }
+
+    /** @return Red value (0-255) */
+    int getRedValue() const
+    {
+        return (rgb>>16) & 0xff;
+    }
+
+    /** @return Green value (0-255) */
+    int getGreenValue() const
+    {
+        return (rgb>>8) & 0xff;
+    }
+
+    /** @return Blue value (0-255) */
+    int getBlueValue() const
+    {
+        return rgb & 0xff;
+    }
+
+    bool operator==(const StyleColour& r) const
+    {
+        return rgb==r.rgb;
+    }
+
+    bool operator!=(const StyleColour& r) const
+    {
+        return rgb!=r.rgb;
+    }
 
 private:
-    RGBVal rgb;
-    string int2str(int, std::ios_base& (*f)(std::ios_base&) ) const;
-    string float2str(double) const;
+    uint32_t rgb; ///< packed 0xRRGGBB value
+
+    /** @param value colour component (0-255)
+        @param type Output type
+        @return formatted component, looked up in a table which is built on first use */
+    static const string& formatComponent(int value, OutputType type);
+
+    static string int2str(int, std::ios_base& (*f)(std::ios_base&) );
+    static string float2str(double);
 };
 
 }
@@ -36,11 +36,26 @@ along with Highlight.  If not, see <http://www.gnu.org/licenses/>.
 namespace ansifilter
 {
 
+/// replacement strings of SVG special characters
+static constexpr EscapeTable makeSvgEscapeTable()
+{
+    EscapeTable table{};
+    table[' '] = "&#160;";
+    table['<'] = "&lt;";
+    table['>'] = "&gt;";
+    table['&'] = "&amp;";
+    table['\"'] = "&quot;";
+    return table;
+}
+
+static constexpr EscapeTable svgEscapeTable = makeSvgEscapeTable();
+
 SVGGenerator::SVGGenerator()
     : CodeGenerator ( SVG ),
      fileSuffix(".svg")
 {
     spacer = "&#160;";
+    escapeTable = &svgEscapeTable;
     newLineTag = "\n";
     styleCommentOpen="/*";
     styleCommentClose="*/";
@@ -57,32 +72,7 @@ string SVGGenerator::getOpenTag()
     if (applyDynStyles){
         attrName = "class";
 
-        ostringstream fgColStream;
-         if (elementStyle.isFgColorSet()) {
-            fgColStream << elementStyle.getFgColour().getRed(HTML)
-                        << elementStyle.getFgColour().getGreen(HTML)
-                        << elementStyle.getFgColour().getBlue(HTML);
-         }
-
-        ostringstream bgColStream;
-        if (elementStyle.isBgColorSet()) {
-
-            bgColStream << elementStyle.getBgColour().getRed(HTML)
-                        << elementStyle.getBgColour().getGreen(HTML)
-                        << elementStyle.getBgColour().getBlue(HTML);
-        }
-
-        StyleInfo sInfo( fgColStream.str(), bgColStream.str(),
-                         elementStyle.isBold(), elementStyle.isItalic(), elementStyle.isConceal(),
-                         elementStyle.isBlink(), elementStyle.isUnderline() );
-
-        auto fit = std::find(documentStyles.begin(), documentStyles.end(), sInfo );
-        if (fit == documentStyles.end()){
-            documentStyles.push_back(sInfo);
-            fmtStream << "af_"<< documentStyles.size();
-        } else {
-            fmtStream << "af_"<< 1+(int)std::distance(documentStyles.begin(), fit);
-        }
+        fmtStream << "af_"<< registerDocumentStyle( StyleInfo( elementStyle ) );
 
     } else {
 
@@ -184,13 +174,23 @@ string SVGGenerator::getHeader()
 }
 
 void SVGGenerator::printBody()
+{
+    printBodyBegin();
+    processInput();
+    printBodyEnd();
+}
+
+void SVGGenerator::printBodyBegin()
 {
     *out << "<g>\n<rect x=\"0\" y=\"0\" width=\"100%\" height=\"100%\"/>"; // rect: background color
     int fontSizeSVG=10;
     StringTools::str2num<int>(fontSizeSVG, fontSize, std::dec);
 
     *out << "\n<text x=\"10\" y=\""<<fontSizeSVG*2<<"\">";
-    processInput();
+}
+
+void SVGGenerator::printBodyEnd()
+{
     *out << "</text>\n</g>\n";
 }
 
@@ -210,29 +210,6 @@ string SVGGenerator::getFooter()
     return os.str();
 }
 
-string SVGGenerator::maskCharacter ( unsigned  char c )
-{
-    switch ( c ) {
-    case ' ' :
-        return spacer;
-        break;
-    case '<' :
-        return "&lt;";
-        break;
-    case '>' :
-        return "&gt;";
-        break;
-    case '&' :
-        return "&amp;";
-        break;
-    case '\"' :
-        return "&quot;";
-        break;
-    default:
-        return string( 1, c );;
-    }
-}
-
 void SVGGenerator::insertLineNumber()
 {
 
@@ -240,15 +217,9 @@ void SVGGenerator::insertLineNumber()
     StringTools::str2num<int>(fontSizeSVG, fontSize, std::dec);
 
     if ( showLineNumbers ) {
-        ostringstream lnum;
-        lnum << setw ( 5 ) << right;
-
         if ( numberCurrentLine ) {
-            lnum << lineNumber;
             *out<< "</text>\n<text x=\"10\" y=\""<< ( lineNumber*fontSizeSVG*2 ) <<"\">";
-            *out << lnum.str() ;
-        } else {
-            *out << lnum.str(); //for indentation
+            *out << formatLineNumber() ;
         }
         *out << " ";
     } else {
@@ -274,9 +245,10 @@ bool SVGGenerator::printDynamicStyleFile ( const std::string &outPath ) {
         indexfile << "g { font-size: " << fontSize;
         indexfile << "; font-family: " << font << "; white-space: pre; }\n";
 
+        const vector<StyleInfo> documentStyles = styleRegistry->getStyles();
         for (unsigned int i=0; i<documentStyles.size();i++){
             StyleInfo sInfo = documentStyles[i];
-            indexfile << "tspan.af_" << (i+1) <<" {";
+            indexfile << "tspan.af_" << styleRegistry->getClassNumber(sInfo) <<" {";
 
             if (sInfo.isBold) {
                 indexfile<< "font-weight:bold;";
@@ -294,15 +266,17 @@ bool SVGGenerator::printDynamicStyleFile ( const std::string &outPath ) {
                 indexfile<< "display:none;";
             }
 
-            if (sInfo.fgColor.size()) {
+            if (sInfo.isFgColorSet) {
                 indexfile << "fill:#"
-                          << sInfo.fgColor
+                          << sInfo.fgColour.getRed(HTML)
+                          << sInfo.fgColour.getGreen(HTML)
+                          << sInfo.fgColour.getBlue(HTML)
                           << ";";
             }
 
-           /* if (sInfo.bgColor!="") {
+           /* if (sInfo.isBgColorSet) {
                 indexfile << "background-color:#"
-                          << sInfo.bgColor
+                          << sInfo.bgColour
                           << ";";
             }*/
 
@@ -73,12 +73,15 @@ private:
     /** Print document body*/
     void printBody();
 
+    /** Print the SVG elements which contain the text */
+    void printBodyBegin();
+
+    /** Close the SVG elements of the text */
+    void printBodyEnd();
+
     /** Print document footer*/
     string getFooter();
 
-    /** \return escaped character*/
-    virtual string maskCharacter(unsigned char );
-
 };
 
 }
@@ -8,4 +8,4 @@
 # script is sourced, the variable $dir must contain the
 # full path name of this file's directory.
 
-package ifneeded ansifilter 0.2 [list load [file join $dir tclansifilter.so]]
+package ifneeded ansifilter 0.3 [list load [file join $dir tclansifilter.so]]
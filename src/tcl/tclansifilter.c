@@ -2,27 +2,70 @@
  * tclansifilter.c -- a minimal Tcl wrapper for ansifilter
  */
 #include <tcl.h>
+#include <cerrno>
+#include <cstring>
 #include <memory>
+#include <string>
+#include <string_view>
 #include "../codegenerator.h"
 
 // Tcl namespace
 #define NS "ansifilter"
 
+// key of the generator pool in the interpreter's associated data
+#define POOL_KEY "ansifilter::pool"
+
 // ansifilter requires C++ compiler
 extern "C" {
 
+/*
+ * Generators of an interpreter, one per output type. They are created on first
+ * use and reused by all following commands; generate() resets the parser state.
+ */
+typedef struct {
+    std::unique_ptr<ansifilter::CodeGenerator> generators[ansifilter::SVG + 1];
+    std::string result;
+} GeneratorPool;
+
+static void
+DeletePool(ClientData cdata, Tcl_Interp *interp)
+{
+    delete static_cast<GeneratorPool *>(cdata);
+}
+
+static ansifilter::CodeGenerator *
+GetGenerator(ansifilter::OutputType type, Tcl_Interp *interp, GeneratorPool **poolPtr)
+{
+    GeneratorPool *pool = static_cast<GeneratorPool *>(Tcl_GetAssocData(interp, POOL_KEY, NULL));
+    if (pool == NULL) {
+        pool = new GeneratorPool;
+        Tcl_SetAssocData(interp, POOL_KEY, DeletePool, pool);
+    }
+    std::unique_ptr<ansifilter::CodeGenerator> &generator = pool->generators[type];
+    if (!generator) {
+        generator.reset(ansifilter::CodeGenerator::getInstance(type));
+        generator->setFragmentCode(1);     // -f
+        generator->setPlainOutput(0);
+    }
+    *poolPtr = pool;
+    return generator.get();
+}
 
 static int
 Execute_Escape_Cmd(ansifilter::OutputType type, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
 {
     int i;
-    // XXX this creates and destroys new instances for every call!
-    std::unique_ptr<ansifilter::CodeGenerator> generator(ansifilter::CodeGenerator::getInstance(type));
-    generator->setFragmentCode(1);     // -f
-    generator->setPlainOutput(0);
+    GeneratorPool *pool;
+    ansifilter::CodeGenerator *generator = GetGenerator(type, interp, &pool);
+
+    // the result buffer keeps its capacity between commands
+    pool->result.clear();
     for (i = 1; i < objc; i++) {
-        Tcl_AppendResult(interp, generator->generateString(Tcl_GetString(objv[i])).c_str(), NULL);
+        int len = 0;
+        const char *arg = Tcl_GetStringFromObj(objv[i], &len);
+        generator->generateAppend(std::string_view(arg, len), pool->result);
     }
+    Tcl_SetObjResult(interp, Tcl_NewStringObj(pool->result.data(), (int)pool->result.size()));
     return TCL_OK;
 }
 
@@ -61,6 +104,233 @@ PangoEscape_Cmd(ClientData cdata, Tcl_Interp *interp, int objc, Tcl_Obj *const o
 {
     return Execute_Escape_Cmd(ansifilter::PANGO, interp, objc, objv);
 }
+
+/*
+ * Channel transform: data written to the channel is converted and passed to
+ * the underlying channel; data read from the channel is converted after it
+ * was read from the underlying channel. Each direction has its own generator,
+ * which is fed with the data as it arrives (see CodeGenerator::feed()).
+ */
+typedef struct {
+    Tcl_Channel chan;          // the transform channel
+    Tcl_Channel parent;        // the underlying channel
+    std::string converted;     // converted input which was not yet read
+    size_t convertedPos;
+    // declared after converted, which the reader's callback appends to
+    std::unique_ptr<ansifilter::CodeGenerator> writer;
+    std::unique_ptr<ansifilter::CodeGenerator> reader;
+    bool readerFinished;
+    bool writeFailed;
+    Tcl_TimerToken timer;
+} FilterData;
+
+static ansifilter::CodeGenerator *
+NewFilterGenerator(ansifilter::OutputType type, int fragment)
+{
+    ansifilter::CodeGenerator *generator = ansifilter::CodeGenerator::getInstance(type);
+    generator->setFragmentCode(fragment);
+    generator->setPlainOutput(0);
+    return generator;
+}
+
+static int
+FilterClose(ClientData instanceData, Tcl_Interp *interp)
+{
+    FilterData *fd = static_cast<FilterData *>(instanceData);
+    int result = 0;
+
+    if (fd->timer) {
+        Tcl_DeleteTimerHandler(fd->timer);
+    }
+    // the rest of the document follows the data written so far
+    if (fd->writer && (fd->writer->finish() != ansifilter::PARSE_OK || fd->writeFailed)) {
+        result = EIO;
+    }
+    // input which was not read up to EOF is discarded
+    fd->reader.reset();
+    delete fd;
+    return result;
+}
+
+static int
+FilterInput(ClientData instanceData, char *buf, int toRead, int *errorCodePtr)
+{
+    FilterData *fd = static_cast<FilterData *>(instanceData);
+    char raw[16384];
+
+    while (fd->convertedPos == fd->converted.size() && !fd->readerFinished) {
+        fd->converted.clear();
+        fd->convertedPos = 0;
+
+        int n = Tcl_ReadRaw(fd->parent, raw, sizeof raw);
+        if (n < 0) {
+            *errorCodePtr = Tcl_GetErrno();
+            return -1;
+        }
+        if (n > 0) {
+            fd->reader->feed(raw, n);
+        } else if (Tcl_Eof(fd->parent)) {
+            fd->reader->finish();
+            fd->readerFinished = true;
+        } else {
+            *errorCodePtr = EWOULDBLOCK;
+            return -1;
+        }
+    }
+
+    int cnt = (int)std::min<size_t>(toRead, fd->converted.size() - fd->convertedPos);
+    memcpy(buf, fd->converted.data() + fd->convertedPos, cnt);
+    fd->convertedPos += cnt;
+    return cnt;
+}
+
+static int
+FilterOutput(ClientData instanceData, const char *buf, int toWrite, int *errorCodePtr)
+{
+    FilterData *fd = static_cast<FilterData *>(instanceData);
+
+    if (!fd->writer->feed(buf, toWrite) || fd->writeFailed) {
+        *errorCodePtr = EIO;
+        return -1;
+    }
+    return toWrite;
+}
+
+static void
+FilterTimer(ClientData instanceData)
+{
+    FilterData *fd = static_cast<FilterData *>(instanceData);
+    fd->timer = NULL;
+    Tcl_NotifyChannel(fd->chan, TCL_READABLE);
+}
+
+static void
+FilterWatch(ClientData instanceData, int mask)
+{
+    FilterData *fd = static_cast<FilterData *>(instanceData);
+    Tcl_DriverWatchProc *watchProc = Tcl_ChannelWatchProc(Tcl_GetChannelType(fd->parent));
+    watchProc(Tcl_GetChannelInstanceData(fd->parent), mask);
+
+    // converted data does not make the underlying channel readable
+    if ((mask & TCL_READABLE) && fd->convertedPos < fd->converted.size()) {
+        if (!fd->timer) {
+            fd->timer = Tcl_CreateTimerHandler(0, FilterTimer, fd);
+        }
+    } else if (fd->timer) {
+        Tcl_DeleteTimerHandler(fd->timer);
+        fd->timer = NULL;
+    }
+}
+
+static int
+FilterGetHandle(ClientData instanceData, int direction, ClientData *handlePtr)
+{
+    FilterData *fd = static_cast<FilterData *>(instanceData);
+    return Tcl_GetChannelHandle(fd->parent, direction, handlePtr);
+}
+
+static int
+FilterBlockMode(ClientData instanceData, int mode)
+{
+    return 0;
+}
+
+static int
+FilterHandler(ClientData instanceData, int interestMask)
+{
+    return interestMask;
+}
+
+static const Tcl_ChannelType filterChannelType = {
+    "ansifilter",
+    TCL_CHANNEL_VERSION_5,
+    FilterClose,
+    FilterInput,
+    FilterOutput,
+    NULL,               // seekProc
+    NULL,               // setOptionProc
+    NULL,               // getOptionProc
+    FilterWatch,
+    FilterGetHandle,
+    NULL,               // close2Proc
+    FilterBlockMode,
+    NULL,               // flushProc
+    FilterHandler,
+    NULL,               // wideSeekProc
+    NULL,               // threadActionProc
+    NULL                // truncateProc
+};
+
+/*
+ * ansifilter::filter channel ?-format text|html|pango|tex|latex|rtf|bbcode|svg? ?-fragment bool?
+ * Use "chan pop channel" to remove the transform.
+ */
+static int
+Filter_Cmd(ClientData cdata, Tcl_Interp *interp, int objc, Tcl_Obj *const objv[])
+{
+    static const char *options[] = {"-format", "-fragment", NULL};
+    static const char *formats[] = {"text", "html", "pango", "tex", "latex", "rtf", "bbcode", "svg", NULL};
+    static const ansifilter::OutputType formatTypes[] = {
+        ansifilter::TEXT, ansifilter::HTML, ansifilter::PANGO, ansifilter::TEX,
+        ansifilter::LATEX, ansifilter::RTF, ansifilter::BBCODE, ansifilter::SVG
+    };
+    ansifilter::OutputType type = ansifilter::TEXT;
+    int fragment = 1;
+    int mode, i, index;
+
+    if (objc < 2 || objc % 2 != 0) {
+        Tcl_WrongNumArgs(interp, 1, objv, "channel ?-format format? ?-fragment bool?");
+        return TCL_ERROR;
+    }
+    Tcl_Channel parent = Tcl_GetChannel(interp, Tcl_GetString(objv[1]), &mode);
+    if (parent == NULL) {
+        return TCL_ERROR;
+    }
+    for (i = 2; i < objc; i += 2) {
+        if (Tcl_GetIndexFromObj(interp, objv[i], options, "option", 0, &index) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        if (index == 0) {
+            if (Tcl_GetIndexFromObj(interp, objv[i + 1], formats, "format", 0, &index) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            type = formatTypes[index];
+        } else if (Tcl_GetBooleanFromObj(interp, objv[i + 1], &fragment) != TCL_OK) {
+            return TCL_ERROR;
+        }
+    }
+
+    FilterData *fd = new FilterData;
+    fd->parent = parent;
+    fd->convertedPos = 0;
+    fd->readerFinished = false;
+    fd->writeFailed = false;
+    fd->timer = NULL;
+
+    if (mode & TCL_WRITABLE) {
+        fd->writer.reset(NewFilterGenerator(type, fragment));
+        fd->writer->begin([fd](std::string_view s) {
+            if (Tcl_WriteRaw(fd->parent, s.data(), (int)s.size()) < 0) {
+                fd->writeFailed = true;
+            }
+        });
+    }
+    if (mode & TCL_READABLE) {
+        fd->reader.reset(NewFilterGenerator(type, fragment));
+        fd->reader->begin([fd](std::string_view s) {
+            fd->converted.append(s.data(), s.size());
+        });
+    }
+
+    fd->chan = Tcl_StackChannel(interp, &filterChannelType, fd, mode, parent);
+    if (fd->chan == NULL) {
+        delete fd;
+        return TCL_ERROR;
+    }
+    Tcl_SetObjResult(interp, Tcl_NewStringObj(Tcl_GetChannelName(fd->chan), -1));
+    return TCL_OK;
+}
+
 /*
  * Tclansifilter_Init -- Called when Tcl loads your extension.
  */
@@ -71,7 +341,7 @@ Tclansifilter_Init(Tcl_Interp *interp)
         return TCL_ERROR;
     }
     // provide package
-    if (Tcl_PkgProvide(interp, "ansifilter", "0.2") == TCL_ERROR) {
+    if (Tcl_PkgProvide(interp, "ansifilter", "0.3") == TCL_ERROR) {
         return TCL_ERROR;
     }
     // create command
@@ -81,6 +351,7 @@ Tclansifilter_Init(Tcl_Interp *interp)
     Tcl_CreateObjCommand(interp, NS "::text", TextEscape_Cmd, NULL, NULL);
     Tcl_CreateObjCommand(interp, NS "::bbcode", BBCodeEscape_Cmd, NULL, NULL);
     Tcl_CreateObjCommand(interp, NS "::pango", PangoEscape_Cmd, NULL, NULL);
+    Tcl_CreateObjCommand(interp, NS "::filter", Filter_Cmd, NULL, NULL);
 
     return TCL_OK;
 }
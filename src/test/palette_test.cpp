@@ -0,0 +1,148 @@
+/***************************************************************************
+                          palette_test.cpp  -  description
+                             -------------------
+    copyright            : (C) 2024 by Andre Simon
+    email                : a.simon@mailbox.org
+ ***************************************************************************/
+
+/*
+This file is part of ANSIFilter.
+
+ANSIFilter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ANSIFilter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Converts the same input in N threads, each with its own generator and
+   colour map (setColorMap), and compares every result with the output of
+   a single threaded conversion using the same map. Generators must not
+   share palette state, so any difference is a failure.
+
+   usage: palette_test TMPDIR [THREADS] [ROUNDS] */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "codegenerator.h"
+
+using ansifilter::CodeGenerator;
+
+/** \return input which uses all 16 palette colours as foreground and background */
+static std::string paletteInput()
+{
+    std::ostringstream os;
+    for (int line=0; line<50; line++) {
+        for (int c=0; c<8; c++) {
+            os << "\033[" << 30+c << ";" << 47-c << "mfg" << c
+               << "\033[" << 90+c << ";" << 107-c << "mbright" << c << "\033[0m ";
+        }
+        os << "\n";
+    }
+    return os.str();
+}
+
+/** Writes a colour map with 16 distinct colours for the given thread
+    \param path map file
+    \param id thread number
+    \return true if the file was written */
+static bool writeMap(const std::string& path, int id)
+{
+    std::ofstream map(path);
+    for (int idx=0; idx<16; idx++) {
+        map << idx << "=#" << std::hex << std::setfill('0')
+            << std::setw(2) << (id*16+idx)%256
+            << std::setw(2) << (255-id*7)%256
+            << std::setw(2) << (idx*13+id)%256 << std::dec << "\n";
+    }
+    return bool(map);
+}
+
+/** \return new HTML generator which uses the colour map, nullptr on error */
+static CodeGenerator* createGenerator(const std::string& mapPath)
+{
+    CodeGenerator* generator = CodeGenerator::getInstance(ansifilter::HTML);
+    generator->setFragmentCode(true);
+    if (!generator->setColorMap(mapPath)) {
+        delete generator;
+        return nullptr;
+    }
+    return generator;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc<2) {
+        std::cerr << "usage: palette_test TMPDIR [THREADS] [ROUNDS]\n";
+        return EXIT_FAILURE;
+    }
+    const std::string dir = argv[1];
+    const int threads = argc>2 ? atoi(argv[2]) : 8;
+    const int rounds = argc>3 ? atoi(argv[3]) : 50;
+    const std::string input = paletteInput();
+
+    // reference output of each map, converted one after another
+    std::vector<std::string> maps(threads), expected(threads);
+    for (int i=0; i<threads; i++) {
+        maps[i] = dir + "/palette" + std::to_string(i) + ".map";
+        std::unique_ptr<CodeGenerator> generator;
+        if (writeMap(maps[i], i)) {
+            generator.reset(createGenerator(maps[i]));
+        }
+        if (!generator) {
+            std::cerr << "palette_test: could not use map " << maps[i] << "\n";
+            return EXIT_FAILURE;
+        }
+        generator->generate(input, expected[i]);
+        if (i>0 && expected[i]==expected[0]) {
+            std::cerr << "palette_test: maps 0 and " << i << " yield the same output\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    // each thread owns a generator with its own map; the maps are loaded
+    // while other threads already convert
+    std::atomic<int> failures(0);
+    std::vector<std::thread> workers;
+    for (int i=0; i<threads; i++) {
+        workers.emplace_back([&, i]() {
+            std::unique_ptr<CodeGenerator> generator(createGenerator(maps[i]));
+            std::string output;
+            for (int r=0; generator && r<rounds; r++) {
+                generator->generate(input, output);
+                if (output!=expected[i]) {
+                    ++failures;
+                    return;
+                }
+            }
+            if (!generator) ++failures;
+        });
+    }
+    for (auto& t: workers) {
+        t.join();
+    }
+
+    if (failures) {
+        std::cerr << "palette_test: " << failures << " of " << threads
+                  << " threads produced wrong colours\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
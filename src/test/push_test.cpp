@@ -0,0 +1,151 @@
+/***************************************************************************
+                          push_test.cpp  -  description
+                             -------------------
+    copyright            : (C) 2024 by Andre Simon
+    email                : a.simon@mailbox.org
+ ***************************************************************************/
+
+/*
+This file is part of ANSIFilter.
+
+ANSIFilter is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ANSIFilter is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Converts the same input with generate() and incrementally with begin(),
+   feed() and finish(), in pieces of random size. Every output format is
+   tested with and without line numbers and wrapping. The incremental output
+   must be identical, so any difference is a failure.
+
+   usage: push_test [ROUNDS] [MAXPIECE] [FILE...] */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "codegenerator.h"
+
+using ansifilter::CodeGenerator;
+
+/** \return input with sequences which are split by small pieces: SGR and
+    other CSI sequences, hyperlinks, CR, erased lines, tabs, UTF-8 and lines
+    longer than the wrapping width */
+static std::string sampleInput()
+{
+    std::ostringstream os;
+    for (int line=0; line<40; line++) {
+        os << "\033[" << 31+line%7 << ";" << 40+line%8 << "mline " << line << "\033[0m\t"
+           << "\033[1;4;38;5;" << line*6 << "mbold \xc3\xa4\xe2\x82\xac\033[22;24m "
+           << "\033[38;2;" << line << ";100;200m<&>\"\033[39m ";
+        if (line%5==0) os << "\033]8;;http://example.org/" << line << "\033\\link\033]8;;\033\\ ";
+        if (line%7==0) os << "overwritten\rnew ";
+        if (line%9==0) os << "erased\033[K\033[2Cmoved ";
+        os << std::string(line*3, 'x') << "\n";
+    }
+    os << "\033[7mlast line without newline";
+    return os.str();
+}
+
+/** \return contents of the file, empty if it could not be read */
+static std::string readFile(const char* path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+struct Variant {
+    const char* name;
+    bool lineNumbers;
+    bool wrap;
+};
+
+int main(int argc, char* argv[])
+{
+    const int rounds = argc>1 ? atoi(argv[1]) : 20;
+    const int maxPiece = argc>2 ? atoi(argv[2]) : 64;
+    if (rounds<1 || maxPiece<1) {
+        std::cerr << "usage: push_test [ROUNDS] [MAXPIECE] [FILE...]\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> inputs(1, sampleInput());
+    for (int i=3; i<argc; i++) {
+        inputs.push_back(readFile(argv[i]));
+        if (inputs.back().empty()) {
+            std::cerr << "push_test: could not read " << argv[i] << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    const ansifilter::OutputType types[] = {
+        ansifilter::TEXT, ansifilter::HTML, ansifilter::PANGO, ansifilter::TEX,
+        ansifilter::LATEX, ansifilter::RTF, ansifilter::BBCODE, ansifilter::SVG
+    };
+    const Variant variants[] = {
+        { "default", false, false }, { "-l", true, false },
+        { "-w 40", false, true }, { "-l -w 40", true, true }
+    };
+
+    std::mt19937 random(1);
+    std::uniform_int_distribution<size_t> pieceSize(1, maxPiece);
+    int failures = 0;
+
+    for (size_t in=0; in<inputs.size(); in++) {
+        const std::string& input = inputs[in];
+        for (auto type: types) {
+            for (const auto& variant: variants) {
+                std::unique_ptr<CodeGenerator> generator(CodeGenerator::getInstance(type));
+                generator->setShowLineNumbers(variant.lineNumbers);
+                if (variant.wrap) {
+                    generator->setPreformatting(ansifilter::WRAP_SIMPLE, 40);
+                }
+
+                std::string expected;
+                generator->generate(input, expected);
+
+                for (int r=0; r<rounds; r++) {
+                    std::string output;
+                    generator->begin([&output](std::string_view s) { output.append(s); });
+                    for (size_t pos=0; pos<input.size(); ) {
+                        size_t size = std::min(pieceSize(random), input.size()-pos);
+                        generator->feed(input.data()+pos, size);
+                        pos += size;
+                    }
+                    generator->finish();
+
+                    if (output!=expected) {
+                        size_t diff = 0;
+                        while (diff<output.size() && diff<expected.size() && output[diff]==expected[diff]) diff++;
+                        std::cerr << "push_test: input " << in << ", format " << type << ", "
+                                  << variant.name << ", round " << r
+                                  << ": output differs at byte " << diff << "\n";
+                        failures++;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    if (failures) {
+        std::cerr << "push_test: " << failures << " incremental conversions differ from generate()\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -34,6 +34,53 @@ along with ANSIFilter.  If not, see <http://www.gnu.org/licenses/>.
 namespace ansifilter
 {
 
+/// replacement strings of TeX special characters
+static constexpr EscapeTable makeTexEscapeTable()
+{
+    EscapeTable table = makeEscapeTable();
+    table['{'] = "$\\{$";
+    table['}'] = "$\\}$";
+    table['^'] = "{\\bf\\^{}}";
+    table['_'] = "\\_{}";
+    table['&'] = "\\&{}";
+    table['$'] = "\\${}";
+    table['#'] = "\\#{}";
+    table['%'] = "\\%{}";
+    table['\\'] = "$\\backslash$";
+    table[' '] = "\\ ";
+    table['+'] = "$\\mathord{+}$";
+    table['-'] = "$\\mathord{-}$";
+    table['<'] = "$\\mathord{<}$";
+    table['>'] = "$\\mathord{>}$";
+    table['='] = "$\\mathord{=}$";
+    table[AUML_LC] = "\\\"a";
+    table[OUML_LC] = "\\\"o";
+    table[UUML_LC] = "\\\"u";
+    table[AUML_UC] = "\\\"A";
+    table[OUML_UC] = "\\\"O";
+    table[UUML_UC] = "\\\"U";
+    table[AACUTE_LC] = "\\'a";
+    table[EACUTE_LC] = "\\'e";
+    table[OACUTE_LC] = "\\'o";
+    table[UACUTE_LC] = "\\'u";
+    table[AGRAVE_LC] = "\\`a";
+    table[EGRAVE_LC] = "\\`e";
+    table[OGRAVE_LC] = "\\`o";
+    table[UGRAVE_LC] = "\\`u";
+    table[AACUTE_UC] = "\\'A";
+    table[EACUTE_UC] = "\\'E";
+    table[OACUTE_UC] = "\\'O";
+    table[UACUTE_UC] = "\\'U";
+    table[AGRAVE_UC] = "\\`A";
+    table[EGRAVE_UC] = "\\`E";
+    table[UGRAVE_UC] = "\\`O";
+    table[OGRAVE_UC] = "\\`U";
+    table[SZLIG] = "\\ss ";
+    return table;
+}
+
+static constexpr EscapeTable texEscapeTable = makeTexEscapeTable();
+
 TeXGenerator::TeXGenerator ():
     CodeGenerator(TEX),
     fileSuffix(".tex")
@@ -44,6 +91,7 @@ TeXGenerator::TeXGenerator ():
     newLineTag="\\leavevmode\\par\n";
     styleCommentOpen="%";
     spacer  = "\\ ";
+    escapeTable = &texEscapeTable;
 }
 
 string TeXGenerator::getOpenTag()
@@ -110,146 +158,13 @@ void TeXGenerator::printBody()
     processInput();
 }
 
-string TeXGenerator::maskCharacter(unsigned char c)
-{
-    switch (c) {
-    case '{':
-    case '}': {
-        string m( "$\\" );
-        m += c;
-        m += '$';
-        return m;
-    }
-    break;
-    case '^':
-        return "{\\bf\\^{}}";
-        break;
-    case '_':
-    case '&':
-    case '$':
-    case '#':
-    case '%': {
-        string m( "\\" );
-        m += c;
-        m += "{}";
-        return m;
-    }
-    break;
-    case '\\':
-        return "$\\backslash$";
-        break;
-    case ' ':
-        return spacer;
-        break;
-    case '+':
-    case '-':
-    case '<':
-    case '>':
-    case '=': {
-        string m( "$\\mathord{" );
-        m += c;
-        m += "}$";
-        return m;
-    }
-    break;
-    case AUML_LC:
-        return "\\\"a";
-        break;
-    case OUML_LC:
-        return "\\\"o";
-        break;
-    case UUML_LC:
-        return "\\\"u";
-        break;
-    case AUML_UC:
-        return "\\\"A";
-        break;
-    case OUML_UC:
-        return "\\\"O";
-        break;
-    case UUML_UC:
-        return "\\\"U";
-        break;
-    case AACUTE_LC:
-        return "\\'a";
-        break;
-    case EACUTE_LC:
-        return "\\'e";
-        break;
-    case OACUTE_LC:
-        return "\\'o";
-        break;
-    case UACUTE_LC:
-        return "\\'u";
-        break;
-    case AGRAVE_LC:
-        return "\\`a";
-        break;
-    case EGRAVE_LC:
-        return "\\`e";
-        break;
-    case OGRAVE_LC:
-        return "\\`o";
-        break;
-    case UGRAVE_LC:
-        return "\\`u";
-        break;
-    case AACUTE_UC:
-        return "\\'A";
-        break;
-    case EACUTE_UC:
-        return "\\'E";
-        break;
-    case OACUTE_UC:
-        return "\\'O";
-        break;
-    case UACUTE_UC:
-        return "\\'U";
-        break;
-    case AGRAVE_UC:
-        return "\\`A";
-        break;
-    case EGRAVE_UC:
-        return "\\`E";
-        break;
-    case UGRAVE_UC:
-        return "\\`O";
-        break;
-    case OGRAVE_UC:
-        return "\\`U";
-        break;
-    case SZLIG:
-        return "\\ss ";
-        break;
-
-    case '\t' : // see deletion of nonprintable chars below
-        return "\t";
-        break;
-
-    default :
-        if (c>0x1f ) { // printable?
-            return string( 1, c );;
-        } else {
-            return "";
-        }
-    }
-}
-
 void TeXGenerator::insertLineNumber ()
 {
-    if ( showLineNumbers ) {
-
-        ostringstream lnum;
-        lnum << setw ( 5 ) << right;
-        if( numberCurrentLine ) {
-            if (lineNumber>1)
-              *out << getCloseTag();
-            lnum << lineNumber;
-            *out <<"{\\textColor{1 1 1 0} "<<lnum.str()<<spacer<<"}";
-            *out << getOpenTag();
-        } else {
-            *out << lnum.str(); //for indentation
-        }
+    if ( showLineNumbers && numberCurrentLine ) {
+        if (lineNumber>1)
+          *out << closeTag();
+        *out <<"{\\textColor{1 1 1 0} "<<formatLineNumber()<<spacer<<"}";
+        *out << openTag();
     }
 }
 
@@ -74,9 +74,6 @@ private:
     /** Print document footer*/
     string getFooter();
 
-    /** \return escaped character*/
-    virtual string maskCharacter(unsigned char );
-
     void insertLineNumber ();
 };
 
@@ -19,6 +19,6 @@ win32:QMAKE_CXXFLAGS += -std=c++11
 SOURCES += ../main.cpp ../cmdlineoptions.cpp ../arg_parser.cpp
 SOURCES += ../elementstyle.cpp ../plaintextgenerator.cpp ../codegenerator.cpp
 SOURCES += ../platform_fs.cpp ../rtfgenerator.cpp ../htmlgenerator.cpp ../texgenerator.cpp ../latexgenerator.cpp ../bbcodegenerator.cpp ../pangogenerator.cpp ../svggenerator.cpp
-SOURCES += ../stringtools.cpp ../stylecolour.cpp
+SOURCES += ../stringtools.cpp ../stylecolour.cpp ../linereader.cpp ../bytescanner.cpp ../outputsink.cpp ../mappedfile.cpp ../filefollower.cpp ../conversionstats.cpp
 
 win32:QMAKE_POST_LINK = F:\upx393w\upx.exe --best ../../ansifilter.exe